@@ -0,0 +1,370 @@
+#include "ConstraintReader.h"
+#include "ConstraintGraphBuilder.h"
+#include "SimpGraph.h"
+#include "LabelGraph.h"
+#include "LabelReachability.h"
+#include "SyntheticGraph.h"
+#include "UnitCapacityFlow.h"
+#include "Lattice.h"
+#include "TimeManager.h"
+#include "TimeUtil.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <set>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+
+using namespace lemon;
+
+void bench_flow(const std::string& filename, int repeats);
+void bench_lookup(const std::string& filename, int repeats);
+void bench_stages(const std::string& jsonFile, int repeats, int maxNodes);
+
+int main(int argc, char *argv[]) {
+	if (argc < 3) {
+		std::cout << "usage: " << argv[0] << " -flow|-lookup <constraints.xml> [repeats]" << std::endl;
+		std::cout << "       " << argv[0] << " -stages <results.json> [repeats] [max nodes]" << std::endl;
+		return 0;
+	}
+
+	std::string arg(argv[1]);
+	std::string fileName(argv[2]);
+	int repeats = argc > 3 ? std::max(1, atoi(argv[3])) : 5;
+
+	if (arg == "-flow") {
+		bench_flow(fileName, repeats);
+	}
+	else if (arg == "-lookup") {
+		bench_lookup(fileName, repeats);
+	}
+	else if (arg == "-stages") {
+		bench_stages(fileName, repeats, argc > 4 ? atoi(argv[4]) : 100000);
+	}
+}
+
+// freezing releases the list graph, so lookups on it must ask not to freeze
+bool read_constraints(const std::string& filename, SimpGraph& flowGraph, Lattice& securityLattice, bool freeze = true) {
+	std::ifstream fileStream(filename.c_str(), std::ios::in | std::ios::binary);
+	ConstraintGraphBuilder builder(flowGraph, securityLattice);
+	flowGraph.setMetadataSource(filename);
+	ConstraintReader reader(fileStream);
+	if (!reader.run(builder)) {
+		std::cout << "could not read " << filename << std::endl;
+		return false;
+	}
+	securityLattice.computeReachability();
+
+	std::set<std::string> labelNames;
+	for(int i = 0; i <= securityLattice.getMaxId(); ++i)
+		labelNames.insert(Lattice::labelNodeName(i));
+	flowGraph.prepareSuperSink(labelNames);
+	if (freeze)
+		flowGraph.freeze();
+	return true;
+}
+
+// best-of-n wall time of each flow engine on every label's condensed graph
+void bench_flow(const std::string& filename, int repeats) {
+	TimeManager tm;
+	SimpGraph flowGraph(tm);
+	Lattice securityLattice;
+	if (!read_constraints(filename, flowGraph, securityLattice))
+		return;
+
+	LabelReachability reachability(flowGraph);
+	for(int i = 0; i <= securityLattice.getMaxId(); ++i) {
+		std::set<std::string> incompNames;
+		securityLattice.getIncomparableNames(i, incompNames);
+		reachability.addLabel(Lattice::labelNodeName(i), incompNames);
+	}
+	reachability.run();
+	LabelGraph labelGraph(flowGraph, tm);
+
+	std::cout << std::fixed << std::setprecision(6);
+	std::cout << std::setfill('-') << std::setw(90) << "" << std::endl;
+	std::cout << std::setfill(' ') << std::left
+		<< std::setw(14) << "label" << std::setw(10) << "nodes" << std::setw(10) << "arcs"
+		<< std::setw(8) << "flow" << std::setw(14) << "preflow" << std::setw(14) << "unit"
+		<< std::setw(10) << "speedup" << "phases" << std::endl;
+	std::cout << std::setfill('-') << std::setw(90) << "" << std::endl;
+	std::cout << std::setfill(' ');
+
+	double totalPreflow = 0, totalUnit = 0;
+	for(int i = 0; i <= securityLattice.getMaxId(); ++i) {
+		// a label reaching none of its sinks has no network to time
+		if (!reachability.reachesSink(i))
+			continue;
+		std::string iString(Lattice::labelNodeName(i));
+
+		labelGraph.reset();
+		labelGraph.pruneFlowGraph(reachability, i);
+		labelGraph.condenseFlowGraph();
+
+		const FlowGraph& g = labelGraph.getCondensedGraph();
+		const CapMap& cap = labelGraph.getCondensedCapacities();
+
+		double bestPreflow = -1, bestUnit = -1;
+		int preflowValue = 0, unitValue = 0, phases = 0;
+		for(int r = 0; r < repeats; ++r) {
+			TimeUtil timer;
+			PreflowType pft(g, cap, labelGraph.getCondensedSource(), labelGraph.getCondensedSink());
+			timer.start();
+			pft.run();
+			timer.stop();
+			preflowValue = pft.flowValue();
+			if (bestPreflow < 0 || timer.seconds() < bestPreflow)
+				bestPreflow = timer.seconds();
+		}
+		for(int r = 0; r < repeats; ++r) {
+			TimeUtil timer;
+			UnitFlowType uft(g, cap, labelGraph.getCondensedSource(), labelGraph.getCondensedSink());
+			timer.start();
+			uft.run();
+			timer.stop();
+			unitValue = uft.flowValue();
+			phases = uft.phases();
+			if (bestUnit < 0 || timer.seconds() < bestUnit)
+				bestUnit = timer.seconds();
+		}
+		totalPreflow += bestPreflow;
+		totalUnit += bestUnit;
+
+		std::cout << std::left << std::setw(14) << iString
+			<< std::setw(10) << countNodes(g) << std::setw(10) << countArcs(g)
+			<< std::setw(8) << preflowValue << std::setw(14) << bestPreflow << std::setw(14) << bestUnit
+			<< std::setw(10) << std::setprecision(2) << (bestUnit > 0 ? bestPreflow / bestUnit : 0) << std::setprecision(6)
+			<< phases << std::endl;
+		if (preflowValue != unitValue)
+			std::cout << "MISMATCH: preflow " << preflowValue << " vs unit " << unitValue << std::endl;
+	}
+
+	std::cout << std::setfill('-') << std::setw(90) << "" << std::endl;
+	std::cout << std::setfill(' ');
+	std::cout << std::left << std::setw(42) << "total" << std::setw(14) << totalPreflow << std::setw(14) << totalUnit << std::endl;
+}
+
+// best-of-n time of a node -> id -> node round trip over every node, through
+// the std::maps SimpGraph used to keep and through its dense arrays
+void bench_lookup(const std::string& filename, int repeats) {
+	TimeManager tm;
+	SimpGraph flowGraph(tm);
+	Lattice securityLattice;
+	if (!read_constraints(filename, flowGraph, securityLattice, false))
+		return;
+
+	const FlowGraph& g = flowGraph.getFlowGraph();
+	std::map<Node, int> nodeToIdMap;
+	std::map<int, Node> idToNodeMap;
+	std::vector<Node> nodes;
+	for(NodeIt v(g); v != INVALID; ++v) {
+		nodeToIdMap[v] = flowGraph.nodeToId(v);
+		idToNodeMap[flowGraph.nodeToId(v)] = v;
+		nodes.push_back(v);
+	}
+	// visit in arc order, as the analysis does, rather than in node order
+	std::vector<Node> visits;
+	for(ArcIt e(g); e != INVALID; ++e) {
+		visits.push_back(g.source(e));
+		visits.push_back(g.target(e));
+	}
+
+	double bestMap = -1, bestDense = -1;
+	long checkMap = 0, checkDense = 0;
+	for(int r = 0; r < repeats; ++r) {
+		TimeUtil timer;
+		long check = 0;
+		timer.start();
+		for(std::vector<Node>::iterator itVisit = visits.begin(); itVisit != visits.end(); ++itVisit) {
+			int id = nodeToIdMap.find(*itVisit)->second;
+			check += id + g.id(idToNodeMap.find(id)->second);
+		}
+		timer.stop();
+		checkMap = check;
+		if (bestMap < 0 || timer.seconds() < bestMap)
+			bestMap = timer.seconds();
+	}
+	for(int r = 0; r < repeats; ++r) {
+		TimeUtil timer;
+		long check = 0;
+		timer.start();
+		for(std::vector<Node>::iterator itVisit = visits.begin(); itVisit != visits.end(); ++itVisit) {
+			int id = flowGraph.nodeToId(*itVisit);
+			check += id + g.id(flowGraph.getNodeForId(id));
+		}
+		timer.stop();
+		checkDense = check;
+		if (bestDense < 0 || timer.seconds() < bestDense)
+			bestDense = timer.seconds();
+	}
+
+	std::cout << std::fixed << std::setprecision(6);
+	std::cout << nodes.size() << " nodes, " << visits.size() << " lookups" << std::endl;
+	std::cout << std::left << std::setw(10) << "map" << bestMap << " s" << std::endl;
+	std::cout << std::left << std::setw(10) << "dense" << bestDense << " s" << std::endl;
+	std::cout << std::left << std::setw(10) << "speedup" << std::setprecision(2) << (bestDense > 0 ? bestMap / bestDense : 0) << std::endl;
+	if (checkMap != checkDense)
+		std::cout << "MISMATCH: map " << checkMap << " vs dense " << checkDense << std::endl;
+}
+
+// one stage's total time per repeat, in seconds
+struct StageResult {
+	std::string stage;
+	int nodes;
+	long long constraints;
+	int labels;
+	int calls;
+	std::vector<double> totals;
+};
+
+// the stages and the TimeManager phases they are read from; pruning is
+// timed around the dominator computation and the compaction, so those are
+// subtracted from it
+static const char* STAGES[][2] = {
+	{ "ingest", "ingest" },
+	{ "freeze", "freeze graph" },
+	{ "copy", "copy graph" },
+	{ "reachability", "label reachability" },
+	{ "prune", "prune graph" },
+	{ "dominators", "compute dominators" },
+	{ "compaction", "compact graph" },
+	{ "condense", "condense graph" },
+	{ "preflow", "minimum cut" },
+	{ "report", "report cut" }
+};
+static const int NUM_STAGES = sizeof(STAGES) / sizeof(STAGES[0]);
+
+// runs the whole pipeline on one synthetic graph and reads every stage's
+// time off the TimeManager phases
+// memory tracking and hardware counters are left off, and no cut is dumped
+// to a dot file, so the stages time only the analysis itself
+void run_stages(const SyntheticGraph& synth, const std::vector<std::string>& names, std::vector<StageResult>& results) {
+	TimeManager tm;
+	SimpGraph flowGraph(tm);
+	Lattice securityLattice;
+
+	// the same calls ConstraintGraphBuilder makes per <con>, without the XML
+	tm.start("ingest");
+	for(int i = 0; i < synth.numLabels(); ++i)
+		securityLattice.addLabel(names[synth.labelIndex(i)], i);
+	for(std::vector< std::pair<int, int> >::const_iterator itLeqs = synth.getLeqs().begin(); itLeqs != synth.getLeqs().end(); ++itLeqs)
+		securityLattice.addLeq(itLeqs->first, itLeqs->second);
+	for(std::vector< std::pair<int, int> >::const_iterator itCons = synth.getConstraints().begin(); itCons != synth.getConstraints().end(); ++itCons) {
+		Symbol lhs = flowGraph.intern(names[itCons->first]);
+		Symbol rhs = flowGraph.intern(names[itCons->second]);
+		flowGraph.addNameConnection(lhs, synth.isDecl(itCons->first), rhs, synth.isDecl(itCons->second));
+	}
+	tm.stop("ingest");
+
+	securityLattice.computeReachability();
+	std::set<std::string> labelNames;
+	for(int i = 0; i <= securityLattice.getMaxId(); ++i)
+		labelNames.insert(Lattice::labelNodeName(i));
+	flowGraph.prepareSuperSink(labelNames);
+
+	// copying needs the list graph, which freeze() releases
+	{
+		SimpGraph copy(tm);
+		flowGraph.copySimpGraph(copy);
+	}
+	flowGraph.freeze();
+
+	tm.start("label reachability");
+	LabelReachability reachability(flowGraph);
+	for(int i = 0; i <= securityLattice.getMaxId(); ++i) {
+		std::set<std::string> incompNames;
+		securityLattice.getIncomparableNames(i, incompNames);
+		reachability.addLabel(Lattice::labelNodeName(i), incompNames);
+	}
+	reachability.run();
+	tm.stop("label reachability");
+
+	std::vector<int> plan;
+	reachability.planOrder(plan);
+	LabelGraph labelGraph(flowGraph, tm);
+	labelGraph.setDotFile("");
+	std::ostringstream discard;
+	for(std::vector<int>::iterator itPlan = plan.begin(); itPlan != plan.end(); ++itPlan) {
+		if (!reachability.reachesSink(*itPlan))
+			continue;
+		labelGraph.reset();
+		labelGraph.pruneFlowGraph(reachability, *itPlan);
+		labelGraph.condenseFlowGraph();
+		labelGraph.performMinimumCut(discard);
+		discard.str("");
+	}
+
+	std::map<std::string, TimeManager::PhaseSummary> phases;
+	tm.summarize(phases);
+	for(int s = 0; s < NUM_STAGES; ++s) {
+		std::map<std::string, TimeManager::PhaseSummary>::iterator itPhase = phases.find(STAGES[s][1]);
+		long long total = itPhase != phases.end() ? itPhase->second.total : 0;
+		if (std::string(STAGES[s][0]) == "prune")
+			total -= phases["compute dominators"].total + phases["compact graph"].total;
+		results[s].calls = itPhase != phases.end() ? itPhase->second.count : 0;
+		results[s].totals.push_back(total / 1e9);
+	}
+}
+
+// every pipeline stage on its own, on synthetic graphs of 1000 names and
+// ten times more up to maxNodes; best, median and mean of the repeats go
+// to jsonFile so runs can be compared stage by stage.  each value is the
+// total of one run over all of its calls of the stage, not a per-call time.
+void bench_stages(const std::string& jsonFile, int repeats, int maxNodes) {
+	std::vector<StageResult> all;
+	std::cout << std::fixed << std::setprecision(6);
+	std::cout << std::left << std::setw(14) << "stage" << std::setw(10) << "nodes" << std::setw(12) << "constraints"
+		<< std::setw(8) << "calls" << std::setw(14) << "best total" << "median total" << std::endl;
+
+	for(int numNodes = 1000; numNodes <= std::max(1000, maxNodes); numNodes *= 10) {
+		SyntheticOptions options;
+		options.numNodes = numNodes;
+		SyntheticGraph synth(options);
+		std::vector<std::string> names(synth.numNames());
+		for(int n = 0; n < synth.numNames(); ++n)
+			names[n] = synth.name(n);
+
+		std::vector<StageResult> results(NUM_STAGES);
+		for(int s = 0; s < NUM_STAGES; ++s) {
+			results[s].stage = STAGES[s][0];
+			results[s].nodes = numNodes;
+			results[s].constraints = synth.getConstraints().size();
+			results[s].labels = synth.numLabels();
+		}
+		for(int r = 0; r < repeats; ++r)
+			run_stages(synth, names, results);
+
+		for(int s = 0; s < NUM_STAGES; ++s) {
+			std::vector<double> sorted(results[s].totals);
+			std::sort(sorted.begin(), sorted.end());
+			std::cout << std::left << std::setw(14) << results[s].stage << std::setw(10) << numNodes << std::setw(12) << results[s].constraints
+				<< std::setw(8) << results[s].calls << std::setw(14) << sorted.front() << sorted[(sorted.size() - 1) / 2] << std::endl;
+			all.push_back(results[s]);
+		}
+	}
+
+	std::ofstream os(jsonFile.c_str());
+	if (!os) {
+		std::cout << "could not write " << jsonFile << std::endl;
+		return;
+	}
+	os << std::setprecision(9);
+	os << "{\n  \"repeats\": " << repeats << ",\n  \"units\": \"seconds per run, summed over the stage's calls in that run\",\n  \"results\": [";
+	for(size_t i = 0; i < all.size(); ++i) {
+		std::vector<double> sorted(all[i].totals);
+		std::sort(sorted.begin(), sorted.end());
+		double mean = 0;
+		for(size_t r = 0; r < sorted.size(); ++r)
+			mean += sorted[r] / sorted.size();
+		os << (i == 0 ? "\n" : ",\n") << "    {\"stage\": \"" << all[i].stage << "\", \"nodes\": " << all[i].nodes
+			<< ", \"constraints\": " << all[i].constraints << ", \"labels\": " << all[i].labels << ", \"calls\": " << all[i].calls
+			<< ", \"total_best_s\": " << sorted.front() << ", \"total_median_s\": " << sorted[(sorted.size() - 1) / 2] << ", \"total_mean_s\": " << mean << "}";
+	}
+	os << "\n  ]\n}\n";
+	std::cout << "wrote " << jsonFile << std::endl;
+}
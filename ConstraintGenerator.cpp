@@ -0,0 +1,178 @@
+// writes a synthetic <constraint-set> for scale benchmarking, and optionally
+// the flow network of one label as LGF for -lgf.  the same seed and options
+// give the same files on every platform.
+
+#include "SyntheticGraph.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdlib.h>
+
+void
+write_name(std::ostream& os, const char* element, const std::string& name, bool decl) {
+	os << "<" << element << " name=\"" << name << "\"";
+	if (decl)
+		os << " canDecl=\"true\"";
+	os << "/>";
+}
+
+bool
+write_xml(const SyntheticGraph& graph, const std::string& fileName) {
+	std::ofstream os(fileName.c_str());
+	if (!os) {
+		std::cout << "could not write " << fileName << std::endl;
+		return false;
+	}
+	os << "<?xml version=\"1.0\"?>\n<constraint-set>\n<lattice>\n";
+	for(int i = 0; i < graph.numLabels(); ++i)
+		os << "<label name=\"" << graph.name(graph.labelIndex(i)) << "\" id=\"" << i << "\"/>\n";
+	for(std::vector< std::pair<int, int> >::const_iterator itLeqs = graph.getLeqs().begin(); itLeqs != graph.getLeqs().end(); ++itLeqs)
+		os << "<lt lhs=\"" << itLeqs->first << "\" rhs=\"" << itLeqs->second << "\"/>\n";
+	os << "</lattice>\n";
+
+	long long line = 0;
+	for(std::vector< std::pair<int, int> >::const_iterator itCons = graph.getConstraints().begin(); itCons != graph.getConstraints().end(); ++itCons) {
+		std::string lhs(graph.name(itCons->first));
+		std::string rhs(graph.name(itCons->second));
+		++line;
+		os << "<con><lhs>";
+		write_name(os, "var", lhs, graph.hasCanDecl(itCons->first));
+		os << "</lhs>";
+		write_name(os, "rhs", rhs, graph.hasCanDecl(itCons->second));
+		if (graph.hasCanDecl(itCons->second)) {
+			os << "<asString>" << lhs << " &lt;= " << rhs << "</asString>";
+			os << "<because>generated flow</because><pos>Generated.jif:" << line << "</pos>";
+		}
+		os << "</con>\n";
+	}
+	os << "</constraint-set>\n";
+	return os.good();
+}
+
+// the network lemon_mincut -lgf reads: canDecl names split into an in and an
+// out node joined by a unit arc, constraints as infinite arcs, and every
+// label the chosen one may not flow to joined to a super sink, the same
+// sinks Lattice::getIncomparableNames gives -xml
+bool
+write_lgf(const SyntheticGraph& graph, int source, const std::string& fileName) {
+	const int INFINITE = 1000;
+	int numLabels = graph.numLabels();
+
+	// reflexive-transitive closure, to find the labels not above the source
+	std::vector<char> leq(numLabels * numLabels, 0);
+	for(int i = 0; i < numLabels; ++i)
+		leq[i * numLabels + i] = 1;
+	for(std::vector< std::pair<int, int> >::const_iterator itLeqs = graph.getLeqs().begin(); itLeqs != graph.getLeqs().end(); ++itLeqs)
+		leq[itLeqs->first * numLabels + itLeqs->second] = 1;
+	for(int k = 0; k < numLabels; ++k)
+		for(int i = 0; i < numLabels; ++i)
+			if (leq[i * numLabels + k])
+				for(int j = 0; j < numLabels; ++j)
+					if (leq[k * numLabels + j])
+						leq[i * numLabels + j] = 1;
+
+	std::vector<int> inNode(graph.numNames()), outNode(graph.numNames());
+	int numGraphNodes = 0;
+	for(int n = 0; n < graph.numNames(); ++n) {
+		inNode[n] = numGraphNodes++;
+		outNode[n] = graph.isDecl(n) ? numGraphNodes++ : inNode[n];
+	}
+	int sink = numGraphNodes++;
+
+	std::ofstream os(fileName.c_str());
+	if (!os) {
+		std::cout << "could not write " << fileName << std::endl;
+		return false;
+	}
+	os << "@nodes\nlabel\tstring\n";
+	for(int n = 0; n < graph.numNames(); ++n) {
+		os << inNode[n] << "\t\"" << graph.name(n) << "\"\n";
+		if (outNode[n] != inNode[n])
+			os << outNode[n] << "\t\"" << graph.name(n) << "\"\n";
+	}
+	os << sink << "\t\"SUPER_SINK\"\n";
+
+	os << "@arcs\n\t\tlabel\tcapacity\tstring\n";
+	int arcId = 0;
+	for(int n = 0; n < graph.numNames(); ++n) {
+		if (outNode[n] != inNode[n])
+			os << inNode[n] << "\t" << outNode[n] << "\t" << arcId++ << "\t1\t\"" << graph.name(n) << "\"\n";
+	}
+	for(std::vector< std::pair<int, int> >::const_iterator itCons = graph.getConstraints().begin(); itCons != graph.getConstraints().end(); ++itCons)
+		os << outNode[itCons->first] << "\t" << inNode[itCons->second] << "\t" << arcId++ << "\t" << INFINITE << "\t\"\"\n";
+	int numSinks = 0;
+	for(int j = 0; j < numLabels; ++j) {
+		if (leq[source * numLabels + j])
+			continue;
+		os << inNode[graph.labelIndex(j)] << "\t" << sink << "\t" << arcId++ << "\t" << INFINITE << "\t\"\"\n";
+		++numSinks;
+	}
+	os << "@attributes\nsource\t" << outNode[graph.labelIndex(source)] << "\ntarget\t" << sink << "\n";
+
+	if (numSinks == 0)
+		std::cout << graph.name(graph.labelIndex(source)) << " may flow to every label; the LGF flow is zero" << std::endl;
+	return os.good();
+}
+
+int main(int argc, char *argv[]) {
+	SyntheticOptions options;
+	std::string xmlFile, lgfFile;
+	int lgfLabel = 1;
+	for(int a = 1; a + 1 < argc; a += 2) {
+		std::string option(argv[a]);
+		std::string value(argv[a + 1]);
+		if (option == "-seed")
+			options.seed = strtoull(value.c_str(), NULL, 10);
+		else if (option == "-nodes")
+			options.numNodes = atoi(value.c_str());
+		else if (option == "-constraints")
+			options.numConstraints = strtoll(value.c_str(), NULL, 10);
+		else if (option == "-depth")
+			options.depth = atoi(value.c_str());
+		else if (option == "-cycles")
+			options.cycles = atof(value.c_str());
+		else if (option == "-decl")
+			options.decl = atof(value.c_str());
+		else if (option == "-nv")
+			options.nv = atof(value.c_str());
+		else if (option == "-skew")
+			options.skew = atof(value.c_str());
+		else if (option == "-lattice")
+			options.lattice = value;
+		else if (option == "-labels")
+			options.labels = atoi(value.c_str());
+		else if (option == "-taint")
+			options.taint = atoi(value.c_str());
+		else if (option == "-o")
+			xmlFile = value;
+		else if (option == "-lgf")
+			lgfFile = value;
+		else if (option == "-lgf-label")
+			lgfLabel = atoi(value.c_str());
+		else {
+			std::cout << "unknown option " << option << std::endl;
+			return 0;
+		}
+	}
+
+	if (xmlFile.empty() || !options.valid()) {
+		std::cout << "usage: " << argv[0] << " -o out.xml [-lgf out.lgf] [-lgf-label id] [-seed n] [-nodes n] [-constraints n]"
+			<< " [-depth n] [-cycles p] [-decl p] [-nv p] [-skew s] [-lattice chain|diamond|powerset] [-labels k] [-taint n]"
+			<< " (a powerset lattice takes at most 12 atoms)" << std::endl;
+		return 0;
+	}
+
+	SyntheticGraph graph(options);
+	if (write_xml(graph, xmlFile))
+		std::cout << "wrote " << graph.getConstraints().size() << " constraints over " << graph.numNodes() << " names and " << graph.numLabels() << " labels to " << xmlFile << std::endl;
+
+	if (!lgfFile.empty()) {
+		int source = std::min(std::max(0, lgfLabel), graph.numLabels() - 1);
+		if (write_lgf(graph, source, lgfFile))
+			std::cout << "wrote " << graph.name(graph.labelIndex(source)) << "'s flow network to " << lgfFile << std::endl;
+	}
+}
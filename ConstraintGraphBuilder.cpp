@@ -0,0 +1,70 @@
+#include "ConstraintGraphBuilder.h"
+
+#include <iostream>
+#include <string.h>
+
+void
+ConstraintGraphBuilder::constraint(const TiXmlElement& con, const ElementExtent& extent) {
+	++numConstraints;
+	const TiXmlElement* lhs = con.FirstChildElement("lhs");
+	const TiXmlElement* rhs = con.FirstChildElement("rhs");
+
+	if (lhs->FirstChildElement()->Attribute("name") == NULL || rhs->Attribute("name") == NULL) {
+		std::cout << "skipping a constraint without names" << std::endl;
+		return;
+	}
+
+	// names are interned straight from the attribute text
+	const char* lhsString = lhs->FirstChildElement()->Attribute("name");
+	const char* rhsString = rhs->Attribute("name");
+	Symbol lhsName = flowGraph.intern(lhsString);
+	Symbol rhsName = flowGraph.intern(rhsString);
+	//std::cout << lhsString << " <= " << rhsString << std::endl;
+
+	bool rhsDecl = false;
+	bool lhsDecl = false;
+
+	if (rhs->Attribute("canDecl") != NULL || strstr(rhsString, "NV") != NULL)
+		rhsDecl = true;
+	if (lhs->FirstChildElement()->Attribute("canDecl") != NULL  || strstr(lhsString, "NV") != NULL)
+		lhsDecl = true;
+
+	flowGraph.addNameConnection(lhsName, lhsDecl, rhsName, rhsDecl);
+
+	if (rhsDecl && con.FirstChildElement("asString") != NULL) {
+		const TiXmlElement* asStringElem = con.FirstChildElement("asString");
+		std::string constraintString(asStringElem->FirstChild()->Value());
+
+		// only remember where the element is; the because and pos strings
+		// are read back if this name ends up in a cut
+		if (constraintString.find("_{def}") > 0) {
+			flowGraph.addMetadataExtent(rhsName, extent);
+		}
+	}
+
+	// for now ignore the other stuff
+}
+
+void
+ConstraintGraphBuilder::lattice(const TiXmlElement& lattice) {
+	for (const TiXmlElement* latticeChild = lattice.FirstChildElement();
+	latticeChild != 0;
+	latticeChild = latticeChild->NextSiblingElement()) {
+		std::string latticeChildValue(latticeChild->Value());
+		if (latticeChildValue == "label") {
+			int id;
+			if (latticeChild->QueryIntAttribute("id", &id) == TIXML_SUCCESS)
+				securityLattice.addLabel(latticeChild->Attribute("name"), id);
+		}
+		if (latticeChildValue == "lt") {
+			int lhsId, rhsId;
+			if (latticeChild->QueryIntAttribute("lhs", &lhsId) == TIXML_SUCCESS &&
+					latticeChild->QueryIntAttribute("rhs", &rhsId) == TIXML_SUCCESS) {
+				securityLattice.addLeq(lhsId, rhsId);
+			}
+			else {
+				std::cout << "failure!" << std::endl;
+			}
+		}
+	}
+}
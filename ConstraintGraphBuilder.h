@@ -0,0 +1,21 @@
+#pragma once
+#include "ConstraintReader.h"
+#include "SimpGraph.h"
+#include "Lattice.h"
+
+#include <string>
+
+// feeds streamed <con> elements into a SimpGraph and <lattice> elements
+// into a Lattice
+class ConstraintGraphBuilder : public ConstraintHandler {
+
+public:
+	SimpGraph& flowGraph;
+	int numConstraints;
+	Lattice& securityLattice;
+
+	ConstraintGraphBuilder(SimpGraph& flowGraph_, Lattice& securityLattice_) : flowGraph(flowGraph_), numConstraints(0), securityLattice(securityLattice_) { }
+
+	void constraint(const TiXmlElement& con, const ElementExtent& extent);
+	void lattice(const TiXmlElement& lattice);
+};
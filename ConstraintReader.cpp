@@ -0,0 +1,185 @@
+#include "ConstraintReader.h"
+
+#include <iostream>
+#include <algorithm>
+
+bool
+ConstraintReader::fill() {
+	if (!is_.good())
+		return false;
+
+	char chunk[CHUNK_SIZE];
+	is_.read(chunk, CHUNK_SIZE);
+	std::streamsize read = is_.gcount();
+	buffer_.append(chunk, read);
+	return read > 0;
+}
+
+bool
+ConstraintReader::find(const std::string& token, size_t from, size_t& found) {
+	size_t searchFrom = from;
+	for (;;) {
+		found = buffer_.find(token, searchFrom);
+		if (found != std::string::npos)
+			return true;
+		// only rescan the tail that could hold a partial match
+		if (buffer_.size() >= token.size())
+			searchFrom = std::max(from, buffer_.size() - token.size() + 1);
+		if (!fill())
+			return false;
+	}
+}
+
+bool
+ConstraintReader::findTagEnd(size_t from, size_t& end) {
+	// the '>' closing a start tag; one inside a quoted attribute value doesn't count
+	char quote = 0;
+	for(end = from; ; ++end) {
+		if (end == buffer_.size() && !fill())
+			return false;
+		char c = buffer_[end];
+		if (quote != 0) {
+			if (c == quote)
+				quote = 0;
+		}
+		else if (c == '"' || c == '\'')
+			quote = c;
+		else if (c == '>')
+			return true;
+	}
+}
+
+bool
+ConstraintReader::findCloseTag(const std::string& name, size_t from, size_t& close) {
+	// </name followed by '>' or whitespace, so </cond> doesn't close a <con>
+	std::string token("</" + name);
+	for (;;) {
+		if (!find(token, from, close))
+			return false;
+		size_t after = close + token.size();
+		if (after == buffer_.size() && !fill())
+			return false;
+		char c = buffer_[after];
+		if (c == '>' || c == ' ' || c == '\t' || c == '\r' || c == '\n')
+			return true;
+		from = after;
+	}
+}
+
+void
+ConstraintReader::compact() {
+	if (pos_ >= CHUNK_SIZE) {
+		buffer_.erase(0, pos_);
+		consumed_ += pos_;
+		pos_ = 0;
+	}
+}
+
+bool
+ConstraintReader::skipMarkup() {
+	// pos_ is on a '<'; skip comments, processing instructions and doctypes
+	size_t end;
+	if (buffer_.compare(pos_, 4, "<!--") == 0) {
+		if (!find("-->", pos_ + 4, end))
+			return false;
+		pos_ = end + 3;
+	}
+	else if (buffer_.compare(pos_, 2, "<?") == 0) {
+		if (!find("?>", pos_ + 2, end))
+			return false;
+		pos_ = end + 2;
+	}
+	else {
+		if (!find(">", pos_ + 2, end))
+			return false;
+		pos_ = end + 1;
+	}
+	return true;
+}
+
+bool
+ConstraintReader::readTagName(std::string& name) {
+	// leaves pos_ on the '<' of the next tag, or past it if it was markup
+	size_t lt;
+	if (!find("<", pos_, lt))
+		return false;
+	pos_ = lt;
+	while (buffer_.size() < pos_ + 4 && fill())
+		;
+
+	name.clear();
+	if (buffer_.compare(pos_, 2, "<?") == 0 || buffer_.compare(pos_, 2, "<!") == 0)
+		return skipMarkup();
+
+	size_t i = pos_ + 1;
+	for (;;) {
+		if (i == buffer_.size() && !fill())
+			return false;
+		char c = buffer_[i];
+		if (c == '>' || c == ' ' || c == '\t' || c == '\r' || c == '\n' || (c == '/' && i > pos_ + 1))
+			break;
+		name += c;
+		++i;
+	}
+	return true;
+}
+
+bool
+ConstraintReader::run(ConstraintHandler& handler) {
+	std::string name;
+
+	do {
+		if (!readTagName(name))
+			return false;
+	} while (name.empty());
+
+	if (name != "constraint-set")
+		return false;
+
+	size_t end;
+	if (!findTagEnd(pos_, end))
+		return false;
+	if (buffer_[end - 1] == '/')
+		return true;
+	pos_ = end + 1;
+
+	for (;;) {
+		compact();
+		if (!readTagName(name))
+			return false;
+		if (name.empty())
+			continue;
+		if (name == "/constraint-set")
+			return true;
+
+		size_t start = pos_;
+		if (!findTagEnd(start, end))
+			return false;
+		if (buffer_[end - 1] != '/') {
+			size_t close;
+			if (!findCloseTag(name, end, close) || !find(">", close, end))
+				return false;
+		}
+		pos_ = end + 1;
+
+		if (name != "con" && name != "lattice")
+			continue;
+
+		fragment_.Clear();
+		fragment_.Parse(buffer_.substr(start, pos_ - start).c_str());
+		const TiXmlElement* element = fragment_.FirstChildElement();
+		if (fragment_.Error() || element == NULL) {
+			std::cout << "skipping malformed <" << name << ">: " << fragment_.ErrorDesc() << std::endl;
+			continue;
+		}
+
+		if (name == "con") {
+			ElementExtent extent;
+			extent.offset = consumed_ + start;
+			extent.length = pos_ - start;
+			handler.constraint(*element, extent);
+		}
+		else
+			handler.lattice(*element);
+	}
+}
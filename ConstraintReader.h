@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef TIXML_USE_STL
+#define TIXML_USE_STL
+#endif
+#include "tinyxml.h"
+
+#include <string>
+#include <istream>
+
+// where an element sits in the input, so it can be read again later
+struct ElementExtent {
+	unsigned long long offset;
+	unsigned int length;
+};
+
+// receives the top-level children of a <constraint-set> one at a time; the
+// element is only valid for the duration of the call
+class ConstraintHandler {
+
+public:
+	virtual ~ConstraintHandler() { }
+
+	virtual void constraint(const TiXmlElement& con, const ElementExtent& extent) = 0;
+	virtual void lattice(const TiXmlElement& lattice) = 0;
+};
+
+// streams a <constraint-set> document without building a DOM for the whole
+// file.  each <con>/<lattice> child is cut out of a sliding buffer and parsed
+// on its own, so memory is bounded by the largest single element.
+class ConstraintReader {
+
+protected:
+	std::istream& is_;
+	std::string buffer_;
+	size_t pos_;
+	unsigned long long consumed_;   // bytes dropped from the front of buffer_
+	TiXmlDocument fragment_;
+
+	static const size_t CHUNK_SIZE = 1 << 16;
+
+	bool fill();
+	bool find(const std::string& token, size_t from, size_t& found);
+	bool findTagEnd(size_t from, size_t& end);
+	bool findCloseTag(const std::string& name, size_t from, size_t& close);
+	bool skipMarkup();
+	bool readTagName(std::string& name);
+	void compact();
+
+public:
+	ConstraintReader(std::istream& is) : is_(is), pos_(0), consumed_(0) { }
+
+	// returns false if the stream has no <constraint-set> root or is truncated
+	bool run(ConstraintHandler& handler);
+};
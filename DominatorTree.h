@@ -0,0 +1,88 @@
+#pragma once
+
+#include <lemon/core.h>
+#include <map>
+#include <vector>
+
+// the dominator tree given by an immediate-dominator map, numbered in
+// preorder.  a node's subtree is the preorder interval [preorder, end), so
+// "does a dominate b" is two integer compares.
+template<class G>
+class DominatorTree
+{
+	typedef typename G::Node Node;
+
+protected:
+	const G& graph;
+
+	std::vector<int> preorder_;     // G::id(node) -> preorder number, -1 if absent
+	std::vector<int> end_;          // G::id(node) -> one past the last preorder in its subtree
+	std::vector<Node> order_;       // preorder number -> node
+
+	int index(const Node& n) const {
+		int id = graph.id(n);
+		return id >= 0 && id < (int) preorder_.size() ? preorder_[id] : -1;
+	}
+
+public:
+	DominatorTree(const G& graph_) : graph(graph_) { }
+
+	// idom maps every reached node but the root to its immediate dominator
+	void build(const Node& root, const std::map<Node, Node>& idom) {
+		int maxId = graph.maxNodeId();
+		preorder_.assign(maxId + 1, -1);
+		end_.assign(maxId + 1, -1);
+		order_.clear();
+
+		// children as a CSR list indexed by G::id of the parent
+		std::vector<int> firstChild(maxId + 2, 0);
+		for(typename std::map<Node, Node>::const_iterator itIdom = idom.begin();
+			itIdom != idom.end();
+			++itIdom) {
+			if (itIdom->first != root && itIdom->second != lemon::INVALID)
+				++firstChild[graph.id(itIdom->second) + 1];
+		}
+		for(int i = 0; i <= maxId; ++i)
+			firstChild[i + 1] += firstChild[i];
+		std::vector<Node> children(firstChild[maxId + 1]);
+		std::vector<int> fill(firstChild.begin(), firstChild.end() - 1);
+		for(typename std::map<Node, Node>::const_iterator itIdom = idom.begin();
+			itIdom != idom.end();
+			++itIdom) {
+			if (itIdom->first != root && itIdom->second != lemon::INVALID)
+				children[fill[graph.id(itIdom->second)]++] = itIdom->first;
+		}
+
+		// iterative preorder walk; the stack holds (node, next child slot)
+		std::vector< std::pair<Node, int> > stack;
+		preorder_[graph.id(root)] = 0;
+		order_.push_back(root);
+		stack.push_back(std::make_pair(root, firstChild[graph.id(root)]));
+		while (!stack.empty()) {
+			int id = graph.id(stack.back().first);
+			int& next = stack.back().second;
+			if (next == firstChild[id + 1]) {
+				end_[id] = order_.size();
+				stack.pop_back();
+				continue;
+			}
+			Node c = children[next++];
+			preorder_[graph.id(c)] = order_.size();
+			order_.push_back(c);
+			stack.push_back(std::make_pair(c, firstChild[graph.id(c)]));
+		}
+	}
+
+	int size() const { return order_.size(); }
+	bool contains(const Node& n) const { return index(n) >= 0; }
+	int preorder(const Node& n) const { return index(n); }
+	int subtreeEnd(const Node& n) const { return end_[graph.id(n)]; }
+	const Node& nodeAt(int preorder) const { return order_[preorder]; }
+
+	// reflexive: every node dominates itself
+	bool dominates(const Node& a, const Node& b) const {
+		int pa = index(a);
+		int pb = index(b);
+		return pa >= 0 && pb >= 0 && pa <= pb && pb < end_[graph.id(a)];
+	}
+};
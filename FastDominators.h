@@ -1,10 +1,16 @@
 #pragma once
-            
-#include <lemon/dfs.h> 
-#include <set>
+
+#include <lemon/core.h>
+#include <map>
+#include <vector>
 #include <string>
 
-template<class G> 
+// Lengauer-Tarjan (the balanced-link variant) over dense arrays.  vertices
+// are renumbered by DFS preorder, 1..numReached, and every per-vertex array
+// is indexed by that number; 0 is the sentinel that the paper calls "0".
+// nodes are mapped to their DFS number through an array indexed by
+// G::id(node), so the only tree lookups left are in filling the result map.
+template<class G>
 class FastDominators
 {
 	typedef typename G::Node Node;
@@ -13,76 +19,64 @@ class FastDominators
 	typedef typename G::ArcIt ArcIt;
 	typedef typename G::InArcIt InArcIt;
 	typedef typename G::OutArcIt OutArcIt;
-	typedef std::map<Node,Node> NodeMap;
-	typedef std::map<Node,int> NodeIntMap;
-	typedef std::map<Node,std::string> NodeStringMap;
-	
-private:
-	class FastDominVisitor: public lemon::DfsVisitor<G> {
-		
-	protected:
-		const G& g;
-		
-	public:
-		
-		FastDominVisitor(const G& g_) : g(g_) { }
-		
-		void reach(const Node& node) {
-			numReached++;
-			sdno[node] = numReached;
-			ndfs[numReached] = node;
-			label[node] = node;
-			ancestor[node] = dummyNode; 
-			child[node] = dummyNode;
-			size[node] = 1;
-		}
-		
-		void discover(const Arc& arc) {
-			parent[g.target(arc)] = g.source(arc); 
-		}
-	};
-	
+
 protected:
 
 	int numReached;
-	Node dummyNode;
-	NodeMap ancestor;
-	NodeMap child;
-	NodeMap label;
-	NodeMap parent;
-	NodeIntMap sdno;
-	NodeIntMap size;
-	NodeStringMap nsm;
-
-	std::map<int,typename G::Node> ndfs;
-	
-	void compress(const Node& v) {
-		if (ancestor[ancestor[v]] != dummyNode) {
-			compress(ancestor[v]);
-			if (sdno[label[ancestor[v]]] < sdno[label[v]]) {
-				label[v] = label[ancestor[v]];
+
+	std::vector<int> dfsNumber;   // G::id(node) -> DFS number, 0 if unreached
+	std::vector<Node> vertex;     // DFS number -> node
+
+	std::vector<int> parent;
+	std::vector<int> semi;
+	std::vector<int> label;
+	std::vector<int> ancestor;
+	std::vector<int> child;
+	std::vector<int> size;
+	std::vector<int> dom;
+
+	// intrusive bucket lists: bucketHead[v] is the first vertex whose
+	// semidominator is v, bucketNext[w] chains the rest
+	std::vector<int> bucketHead;
+	std::vector<int> bucketNext;
+
+	// scratch stacks, kept between calls so they are allocated once
+	std::vector<int> compressPath;
+	std::vector<OutArcIt> dfsStack;
+
+	void compress(int v) {
+		// walk up to the top of the forest path, then apply the recursive
+		// formulation's updates on the way back down
+		compressPath.clear();
+		for(int u = v; ancestor[ancestor[u]] != 0; u = ancestor[u])
+			compressPath.push_back(u);
+
+		while (!compressPath.empty()) {
+			int u = compressPath.back();
+			compressPath.pop_back();
+			if (semi[label[ancestor[u]]] < semi[label[u]]) {
+				label[u] = label[ancestor[u]];
 			}
-			ancestor[v] = ancestor[ancestor[v]];
+			ancestor[u] = ancestor[ancestor[u]];
 		}
 	}
-	
-	const Node& eval(const Node& v) {
-		if (ancestor[v] == dummyNode) {
+
+	int eval(int v) {
+		if (ancestor[v] == 0) {
 			return label[v];
 		}
 		else {
 			compress(v);
-			if (sdno[label[ancestor[v]]] >= sdno[label[v]])
+			if (semi[label[ancestor[v]]] >= semi[label[v]])
 				return label[v];
 			else
 				return label[ancestor[v]];
 		}
 	}
-	
-	void link(const Node& v, const Node& w) {
-		Node s = w;
-		Node tmp;
-		while (sdno[label[w]] < sdno[label[child[s]]]) {
+
+	void link(int v, int w) {
+		int s = w;
+		while (semi[label[w]] < semi[label[child[s]]]) {
 			if (size[s] + size[child[child[s]]] >= 2 * size[child[s]]) {
 				ancestor[child[s]] = s;
 				child[s] = child[child[s]];
@@ -96,101 +90,108 @@ protected:
 		label[s] = label[w];
 		size[v] += size[w];
 		if (size[v] < 2 * size[w]) {
-			tmp = s;
+			int tmp = s;
 			s = child[v];
 			child[v] = tmp;
 		}
-		while (s != dummyNode) {
+		while (s != 0) {
 			ancestor[s] = v;
 			s = child[s];
 		}
 	}
-	
-	void dfs(const G& graph, const Node& node) {
-		numReached++;
-		sdno[node] = numReached;
-		ndfs[numReached] = node;
-		label[node] = node;
-		ancestor[node] = dummyNode; 
-		child[node] = dummyNode;
-		size[node] = 1;
-		for(OutArcIt e(graph, node); e != INVALID; ++e) {
+
+	void reach(const Node& node, int v, int nodeParent, const G& graph) {
+		dfsNumber[graph.id(node)] = v;
+		vertex[v] = node;
+		parent[v] = nodeParent;
+	}
+
+	// preorder numbering with an explicit stack of out-arc iterators, so
+	// long chains cannot overflow the call stack
+	void dfs(const G& graph, const Node& r) {
+		reach(r, ++numReached, 0, graph);
+		dfsStack.clear();
+		dfsStack.push_back(OutArcIt(graph, r));
+		while (!dfsStack.empty()) {
+			OutArcIt& e = dfsStack.back();
+			if (e == lemon::INVALID) {
+				dfsStack.pop_back();
+				continue;
+			}
+			int v = dfsNumber[graph.id(graph.source(e))];
 			Node w = graph.target(e);
-			if (sdno[w] == 0) {
-				parent[w] = node;
-				dfs(graph, w);
+			++e;
+			if (dfsNumber[graph.id(w)] == 0) {
+				reach(w, ++numReached, v, graph);
+				dfsStack.push_back(OutArcIt(graph, w));
 			}
 		}
-	
 	}
-		
+
+	void init(const G& graph) {
+		int n = 0;
+		for(NodeIt va(graph); va != lemon::INVALID; ++va)
+			++n;
+
+		dfsNumber.assign(graph.maxNodeId() + 1, 0);
+		vertex.assign(n + 1, lemon::INVALID);
+		parent.assign(n + 1, 0);
+		semi.assign(n + 1, 0);
+		label.assign(n + 1, 0);
+		ancestor.assign(n + 1, 0);
+		child.assign(n + 1, 0);
+		size.assign(n + 1, 0);
+		dom.assign(n + 1, 0);
+		bucketHead.assign(n + 1, 0);
+		bucketNext.assign(n + 1, 0);
+	}
+
 public:
-	FastDominators(const NodeStringMap& nsm_) : nsm(nsm_) { }
+	FastDominators() : numReached(0) { }
 	virtual ~FastDominators() { }
-	
+
 	void computeImmediateDominatorsFast(const G& graph, const Node& r, std::map< Node, Node >& idom) {
-//		std::cout << "starting fast dominator computation" << std::endl;
-		std::map<Node, std::set<Node> > bucket;
-		std::map<Node, Node> ancestor, label;
-		
-		for(NodeIt va(graph); va != INVALID; ++va) {
-			bucket[va].clear();
-			sdno[va] = 0;
-		}
-		bucket[dummyNode].clear();
-		sdno[dummyNode] = 0;
-		
-		size[dummyNode] = 0;
-		sdno[dummyNode] = 0;
-		ancestor[dummyNode] = dummyNode;
-		label[dummyNode] = dummyNode;
-//		std::cout << "about to run DFS" << std::endl;
-//		FastDominVisitor fdv(graph);
-//		DfsVisit<G> dfsAgent(graph, fdv);
+		init(graph);
 		numReached = 0;
 		dfs(graph, r);
-//		dfsAgent.run(r);
-		
-//		std::cout << "done running DFS " << std::endl;
-		for(int i = numReached; i >= 2; i--) {
-			Node w = ndfs[i];
-			//std::cout << i << ": " << nsm[w] << std::endl;
-			for(InArcIt inc(graph, w); inc != INVALID; ++inc) {
-				Node v = graph.source(inc);
-				Node u = eval(v);
-				if (sdno[u] < sdno[w])
-					sdno[w] = sdno[u];
+
+		for(int v = 1; v <= numReached; ++v) {
+			semi[v] = v;
+			label[v] = v;
+			size[v] = 1;
+		}
+
+		for(int w = numReached; w >= 2; w--) {
+			for(InArcIt inc(graph, vertex[w]); inc != lemon::INVALID; ++inc) {
+				int v = dfsNumber[graph.id(graph.source(inc))];
+				if (v == 0)
+					continue;
+				int u = eval(v);
+				if (semi[u] < semi[w])
+					semi[w] = semi[u];
 			}
 
-			bucket[ndfs[sdno[w]]].insert(w);
-			Node wParent = parent[w];
+			bucketNext[w] = bucketHead[semi[w]];
+			bucketHead[semi[w]] = w;
 
+			int wParent = parent[w];
 			link(wParent, w);
-			while (!bucket[wParent].empty()) {
-				Node v = *(bucket[wParent].begin());
-				bucket[wParent].erase(v);
-				Node u = eval(v);
-				if (sdno[u] < sdno[v])
-					idom[v] = u;
-				else 
-					idom[v] = wParent;
+
+			for(int v = bucketHead[wParent]; v != 0; v = bucketNext[v]) {
+				int u = eval(v);
+				if (semi[u] < semi[v])
+					dom[v] = u;
+				else
+					dom[v] = wParent;
 			}
+			bucketHead[wParent] = 0;
 		}
 
-		for(int i = 2; i <= numReached; i++) {
-			Node w = ndfs[i];
-			if (idom[w] != ndfs[sdno[w]])
-				idom[w] = idom[idom[w]];
-		}
-		
-		for(int i = 0; i <= numReached; ++i) {
-			Node w = ndfs[i];
-			nsm[w];
-			nsm[idom[w]];
-			//so, commenting out the following line causes things to 
-			//break (dominators failed).  what?
-			//std::cout << nsm[w] << " DOM " << nsm[idom[w]] << std::endl;
+		for(int w = 2; w <= numReached; w++) {
+			if (dom[w] != semi[w])
+				dom[w] = dom[dom[w]];
+			idom[vertex[w]] = vertex[dom[w]];
 		}
-		//std::cout << "all done" << std::endl;
+		idom[r] = lemon::INVALID;
 	}
 };
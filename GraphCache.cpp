@@ -0,0 +1,426 @@
+#include "GraphCache.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+
+const char MAGIC[8] = { 'S', 'I', 'M', 'P', 'G', 'R', 'P', 'H' };
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct CacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint64_t payloadSize;
+	uint64_t checksum;
+};
+
+// FNV-1a over 64-bit words; the payload is always padded to whole words
+uint64_t
+checksum(const char* data, size_t size) {
+	uint64_t h = 14695981039346656037ULL;
+	for(size_t i = 0; i + 8 <= size; i += 8) {
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		h ^= word;
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+// the payload is a sequence of arrays, each a 64-bit element count followed
+// by the elements and padding up to the next 8-byte boundary
+class PayloadWriter {
+	std::vector<char>& buffer_;
+public:
+	PayloadWriter(std::vector<char>& buffer) : buffer_(buffer) { }
+
+	template<class T>
+	void putArray(const T* data, size_t count) {
+		uint64_t n = count;
+		buffer_.insert(buffer_.end(), (const char*) &n, (const char*) &n + 8);
+		buffer_.insert(buffer_.end(), (const char*) data, (const char*) data + count * sizeof(T));
+		buffer_.resize((buffer_.size() + 7) & ~size_t(7), 0);
+	}
+	template<class T>
+	void putVector(const std::vector<T>& v) { putArray(v.empty() ? (const T*) 0 : &v[0], v.size()); }
+	void putValue(int64_t value) { putArray(&value, 1); }
+};
+
+class PayloadReader {
+	const char* data_;
+	size_t size_;
+	size_t pos_;
+	bool ok_;
+public:
+	PayloadReader(const char* data, size_t size) : data_(data), size_(size), pos_(0), ok_(true) { }
+
+	bool ok() const { return ok_; }
+
+	template<class T>
+	const T* getArray(size_t& count) {
+		count = 0;
+		uint64_t n;
+		if (!ok_ || pos_ + 8 > size_) {
+			ok_ = false;
+			return 0;
+		}
+		memcpy(&n, data_ + pos_, 8);
+		if (n > (size_ - pos_ - 8) / sizeof(T)) {
+			ok_ = false;
+			return 0;
+		}
+		const T* array = (const T*) (data_ + pos_ + 8);
+		pos_ = (pos_ + 8 + n * sizeof(T) + 7) & ~size_t(7);
+		count = n;
+		return array;
+	}
+	template<class T>
+	void getVector(std::vector<T>& v) {
+		size_t count;
+		const T* array = getArray<T>(count);
+		v.assign(array, array + count);
+	}
+	int64_t getValue() {
+		size_t count;
+		const int64_t* value = getArray<int64_t>(count);
+		if (count != 1) {
+			ok_ = false;
+			return 0;
+		}
+		return *value;
+	}
+};
+
+// a file from another build can carry a valid checksum over a different
+// layout, so every index is checked before it is used
+template<class T>
+bool
+allInRange(const T* values, size_t count, int64_t lo, int64_t hi) {
+	for(size_t i = 0; i < count; ++i) {
+		if ((int64_t) values[i] < lo || (int64_t) values[i] >= hi)
+			return false;
+	}
+	return true;
+}
+
+template<class T>
+bool
+allInRange(const std::vector<T>& values, int64_t lo, int64_t hi) {
+	return values.empty() || allInRange(&values[0], values.size(), lo, hi);
+}
+
+// (symbol, string) pairs as three arrays: symbols, string ends and text
+void
+putStrings(PayloadWriter& writer, const std::map<Symbol, std::string>& strings) {
+	std::vector<uint32_t> symbols;
+	std::vector<uint64_t> ends;
+	std::string text;
+	for(std::map<Symbol, std::string>::const_iterator itStrings = strings.begin();
+		itStrings != strings.end();
+		++itStrings) {
+		symbols.push_back(itStrings->first);
+		text += itStrings->second;
+		ends.push_back(text.size());
+	}
+	writer.putVector(symbols);
+	writer.putVector(ends);
+	writer.putArray(text.data(), text.size());
+}
+
+bool
+getStrings(PayloadReader& reader, std::map<Symbol, std::string>& strings) {
+	size_t numSymbols, numEnds, textSize;
+	const uint32_t* symbols = reader.getArray<uint32_t>(numSymbols);
+	const uint64_t* ends = reader.getArray<uint64_t>(numEnds);
+	const char* text = reader.getArray<char>(textSize);
+	if (!reader.ok() || numSymbols != numEnds)
+		return false;
+	uint64_t begin = 0;
+	for(size_t i = 0; i < numSymbols; ++i) {
+		if (ends[i] < begin || ends[i] > textSize)
+			return false;
+		strings.insert(strings.end(), std::make_pair(symbols[i], std::string(text + begin, ends[i] - begin)));
+		begin = ends[i];
+	}
+	return true;
+}
+
+// a read-only mapping of a whole file, unmapped on destruction
+class MappedFile {
+	void* data_;
+	size_t size_;
+public:
+	MappedFile(const std::string& fileName) : data_(MAP_FAILED), size_(0) {
+		int fd = open(fileName.c_str(), O_RDONLY);
+		if (fd < 0)
+			return;
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			size_ = st.st_size;
+			data_ = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		}
+		close(fd);
+	}
+	~MappedFile() {
+		if (data_ != MAP_FAILED)
+			munmap(data_, size_);
+	}
+	bool ok() const { return data_ != MAP_FAILED; }
+	const char* data() const { return (const char*) data_; }
+	size_t size() const { return size_; }
+};
+
+}
+
+bool
+GraphCache::write(const std::string& fileName, const SimpGraph& graph, const Lattice& lattice, const GraphStats& baseStats) {
+	std::vector<char> payload;
+	PayloadWriter writer(payload);
+
+	const FrozenGraph& frozen = graph.frozen_;
+	int numArcs = countArcs(frozen);
+	std::vector<int32_t> arcs(2 * numArcs);
+	std::vector<int32_t> capacities(numArcs);
+	for(int k = 0; k < numArcs; ++k) {
+		FrozenGraph::Arc a = frozen.arc(k);
+		arcs[2 * k] = frozen.id(frozen.source(a));
+		arcs[2 * k + 1] = frozen.id(frozen.target(a));
+		capacities[k] = graph.frozenCapacities_[a];
+	}
+
+	writer.putValue(graph.nextId);
+	writer.putValue(baseStats.num_nodes);
+	writer.putValue(baseStats.num_edges);
+	writer.putVector(arcs);
+	writer.putVector(capacities);
+
+	writer.putVector(graph.symbols_.arena_);
+	writer.putVector(graph.symbols_.offsets_);
+	writer.putVector(graph.symbols_.hashes_);
+	writer.putVector(graph.idToSymbol_);
+	writer.putVector(graph.symbolToIncomingId_);
+	writer.putVector(graph.symbolToOutgoingId_);
+
+	std::vector<int32_t> declIds(graph.declIds.begin(), graph.declIds.end());
+	std::vector<int32_t> expIds(graph.expIds.begin(), graph.expIds.end());
+	writer.putVector(declIds);
+	writer.putVector(expIds);
+
+	std::vector<uint32_t> sinkSymbols;
+	std::vector<int32_t> sinkArcs;
+	for(std::map<Symbol, FrozenGraph::Arc>::const_iterator itSinkArcs = graph.frozenSuperSinkArcs_.begin();
+		itSinkArcs != graph.frozenSuperSinkArcs_.end();
+		++itSinkArcs) {
+		sinkSymbols.push_back(itSinkArcs->first);
+		sinkArcs.push_back(frozen.index(itSinkArcs->second));
+	}
+	writer.putVector(sinkSymbols);
+	writer.putVector(sinkArcs);
+
+	// the cache has to stand alone, so lazy metadata is fetched here
+	std::map<Symbol, std::string> positions, asStrings;
+	graph.collectMetadata(positions, asStrings);
+	putStrings(writer, positions);
+	putStrings(writer, asStrings);
+
+	// the lattice as its labels and <lt> edges; the closure is recomputed
+	std::vector<int32_t> labelIds;
+	std::vector<uint64_t> labelEnds;
+	std::string labelText;
+	for(std::map<std::string, int>::const_iterator itLabels = lattice.getLabelIds().begin();
+		itLabels != lattice.getLabelIds().end();
+		++itLabels) {
+		labelIds.push_back(itLabels->second);
+		labelText += itLabels->first;
+		labelEnds.push_back(labelText.size());
+	}
+	std::vector<int32_t> leqs;
+	for(std::vector< std::pair<int, int> >::const_iterator itLeqs = lattice.getLeqs().begin();
+		itLeqs != lattice.getLeqs().end();
+		++itLeqs) {
+		leqs.push_back(itLeqs->first);
+		leqs.push_back(itLeqs->second);
+	}
+	writer.putVector(labelIds);
+	writer.putVector(labelEnds);
+	writer.putArray(labelText.data(), labelText.size());
+	writer.putVector(leqs);
+
+	CacheHeader header;
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.byteOrder = BYTE_ORDER_MARK;
+	header.payloadSize = payload.size();
+	header.checksum = checksum(&payload[0], payload.size());
+
+	std::ofstream os(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	os.write((const char*) &header, sizeof(header));
+	os.write(&payload[0], payload.size());
+	os.close();
+	if (!os) {
+		std::cout << "could not write " << fileName << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool
+GraphCache::load(const std::string& fileName, SimpGraph& graph, Lattice& lattice, GraphStats& baseStats) {
+	MappedFile file(fileName);
+	if (!file.ok()) {
+		std::cout << "could not load " << fileName << std::endl;
+		return false;
+	}
+
+	CacheHeader header;
+	if (file.size() < sizeof(header)) {
+		std::cout << fileName << " is not a compiled constraint graph" << std::endl;
+		return false;
+	}
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.byteOrder != BYTE_ORDER_MARK) {
+		std::cout << fileName << " is not a compiled constraint graph" << std::endl;
+		return false;
+	}
+	if (header.version != VERSION) {
+		std::cout << fileName << " has version " << header.version << ", expected " << VERSION << "; recompile it" << std::endl;
+		return false;
+	}
+	const char* payload = file.data() + sizeof(header);
+	if (header.payloadSize != file.size() - sizeof(header) || checksum(payload, header.payloadSize) != header.checksum) {
+		std::cout << fileName << " is truncated or corrupt" << std::endl;
+		return false;
+	}
+
+	PayloadReader reader(payload, header.payloadSize);
+	int64_t nextId = reader.getValue();
+	baseStats.num_nodes = reader.getValue();
+	baseStats.num_edges = reader.getValue();
+
+	size_t numArcEnds, numCapacities;
+	const int32_t* arcs = reader.getArray<int32_t>(numArcEnds);
+	const int32_t* capacities = reader.getArray<int32_t>(numCapacities);
+	if (!reader.ok() || numArcEnds != 2 * numCapacities) {
+		std::cout << fileName << " is truncated or corrupt" << std::endl;
+		return false;
+	}
+	if (nextId < 0 || nextId > INT32_MAX || !allInRange(arcs, numArcEnds, 0, nextId)) {
+		std::cout << fileName << " has arcs outside its " << nextId << " nodes; recompile it" << std::endl;
+		return false;
+	}
+	// StaticDigraph::build needs the arcs grouped by source
+	for(size_t k = 1; k < numCapacities; ++k) {
+		if (arcs[2 * k] < arcs[2 * (k - 1)]) {
+			std::cout << fileName << " has arcs out of source order; recompile it" << std::endl;
+			return false;
+		}
+	}
+	graph.nextId = nextId;
+	std::vector< std::pair<int, int> > arcList(numCapacities);
+	for(size_t k = 0; k < numCapacities; ++k) {
+		arcList[k] = std::make_pair(arcs[2 * k], arcs[2 * k + 1]);
+	}
+	graph.frozen_.build(graph.nextId, arcList.begin(), arcList.end());
+	graph.list_.reset();
+	for(size_t k = 0; k < numCapacities; ++k) {
+		graph.frozenCapacities_[graph.frozen_.arc(k)] = capacities[k];
+	}
+
+	SymbolTable& symbols = graph.symbols_;
+	reader.getVector(symbols.arena_);
+	reader.getVector(symbols.offsets_);
+	reader.getVector(symbols.hashes_);
+	int64_t numSymbols = symbols.hashes_.size();
+	bool symbolsOk = reader.ok() && symbols.offsets_.size() == symbols.hashes_.size() + 1 && symbols.offsets_[0] == 0;
+	for(size_t i = 1; symbolsOk && i < symbols.offsets_.size(); ++i)
+		symbolsOk = symbols.offsets_[i - 1] <= symbols.offsets_[i] && symbols.offsets_[i] <= symbols.arena_.size();
+	if (!symbolsOk) {
+		std::cout << fileName << " has an inconsistent symbol table; recompile it" << std::endl;
+		return false;
+	}
+	size_t slots = 1024;
+	while (slots < 2 * symbols.hashes_.size())
+		slots *= 2;
+	symbols.rehash(slots);
+
+	reader.getVector(graph.idToSymbol_);
+	reader.getVector(graph.symbolToIncomingId_);
+	reader.getVector(graph.symbolToOutgoingId_);
+
+	std::vector<int32_t> declIds, expIds;
+	reader.getVector(declIds);
+	reader.getVector(expIds);
+
+	std::vector<uint32_t> sinkSymbols;
+	std::vector<int32_t> sinkArcs;
+	reader.getVector(sinkSymbols);
+	reader.getVector(sinkArcs);
+
+	if (!getStrings(reader, graph.symbolToPosition_) || !getStrings(reader, graph.symbolToAsString_)) {
+		std::cout << fileName << " is truncated or corrupt" << std::endl;
+		return false;
+	}
+
+	// every id must name a node and every symbol an interned name
+	if ((int64_t) graph.idToSymbol_.size() != nextId
+			|| !allInRange(graph.idToSymbol_, 0, numSymbols)
+			|| graph.symbolToIncomingId_.size() != graph.symbolToOutgoingId_.size()
+			|| (int64_t) graph.symbolToIncomingId_.size() > numSymbols
+			|| !allInRange(graph.symbolToIncomingId_, -1, nextId)
+			|| !allInRange(graph.symbolToOutgoingId_, -1, nextId)
+			|| !allInRange(declIds, 0, nextId) || !allInRange(expIds, 0, nextId)
+			|| sinkSymbols.size() != sinkArcs.size()
+			|| !allInRange(sinkSymbols, 0, numSymbols)
+			|| !allInRange(sinkArcs, 0, numCapacities)
+			|| (!graph.symbolToPosition_.empty() && (int64_t) graph.symbolToPosition_.rbegin()->first >= numSymbols)
+			|| (!graph.symbolToAsString_.empty() && (int64_t) graph.symbolToAsString_.rbegin()->first >= numSymbols)) {
+		std::cout << fileName << " does not match this build's layout; recompile it" << std::endl;
+		return false;
+	}
+
+	graph.declIds.insert(declIds.begin(), declIds.end());
+	graph.expIds.insert(expIds.begin(), expIds.end());
+	for(size_t i = 0; i < sinkSymbols.size(); ++i) {
+		graph.frozenSuperSinkArcs_[sinkSymbols[i]] = graph.frozen_.arc(sinkArcs[i]);
+	}
+
+	std::vector<int32_t> labelIds;
+	std::vector<uint64_t> labelEnds;
+	std::vector<int32_t> leqs;
+	reader.getVector(labelIds);
+	reader.getVector(labelEnds);
+	size_t labelTextSize;
+	const char* labelText = reader.getArray<char>(labelTextSize);
+	reader.getVector(leqs);
+	if (!reader.ok() || labelIds.size() != labelEnds.size()) {
+		std::cout << fileName << " is truncated or corrupt" << std::endl;
+		return false;
+	}
+	if (leqs.size() % 2 != 0 || !allInRange(leqs, 0, INT32_MAX)) {
+		std::cout << fileName << " has an inconsistent lattice; recompile it" << std::endl;
+		return false;
+	}
+	uint64_t begin = 0;
+	for(size_t i = 0; i < labelIds.size(); ++i) {
+		if (labelEnds[i] < begin || labelEnds[i] > labelTextSize) {
+			std::cout << fileName << " has an inconsistent lattice; recompile it" << std::endl;
+			return false;
+		}
+		lattice.addLabel(std::string(labelText + begin, labelEnds[i] - begin), labelIds[i]);
+		begin = labelEnds[i];
+	}
+	for(size_t i = 0; i + 1 < leqs.size(); i += 2) {
+		lattice.addLeq(leqs[i], leqs[i + 1]);
+	}
+	lattice.computeReachability();
+	return true;
+}
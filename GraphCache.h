@@ -0,0 +1,24 @@
+#pragma once
+
+#include "SimpGraph.h"
+#include "Lattice.h"
+#include "GraphStats.h"
+
+#include <string>
+
+// a compiled constraint graph on disk: the frozen CSR arcs and capacities,
+// the interned names, the decl/exp ids, the position and asString metadata
+// and the lattice, behind a versioned header and a checksum of everything
+// after it.  loading maps the file and copies the arrays into place, so
+// nothing is parsed.  the file is only meant for the machine that wrote it.
+class GraphCache {
+
+public:
+	static const unsigned int VERSION = 1;
+
+	// graph must be frozen; baseStats are the stats before the super sink
+	static bool write(const std::string& fileName, const SimpGraph& graph, const Lattice& lattice, const GraphStats& baseStats);
+
+	// fills an empty graph with just its frozen image, ready for analysis
+	static bool load(const std::string& fileName, SimpGraph& graph, Lattice& lattice, GraphStats& baseStats);
+};
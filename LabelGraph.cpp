@@ -0,0 +1,553 @@
+#include "LabelGraph.h"
+
+#include <fstream>
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+
+#include "FastDominators.h"
+#include "DominatorTree.h"
+#include "ResidualCut.h"
+#include "LabelReachability.h"
+
+static std::mutex dotFileMutex;
+
+LabelGraph::LabelGraph(const SimpGraph& base, TimeManager& tm) :
+	base_(base), fg(base.frozen_), tm_(tm),
+	nodeFilter_(base.frozen_, base.frozen_.maxNodeId() + 1, true), arcFilter_(base.frozen_, base.frozen_.maxArcId() + 1, true),
+	view_(base.frozen_, nodeFilter_, arcFilter_),
+	capacities_(base.frozenCapacities_), sinkGroup_(-1),
+	condensedCapacities_(condensed_), condensedOrigin_(condensed_),
+	flowEngine_(PREFLOW_ENGINE), dotFile_("out.dot"), warmStart_(false), flowValue_(0), seededFlow_(0) {
+	// every label starts with all super sink arcs switched off
+	for(std::map<Symbol, Arc>::const_iterator itSinkArcs = base_.frozenSuperSinkArcs_.begin();
+		itSinkArcs != base_.frozenSuperSinkArcs_.end();
+		++itSinkArcs) {
+		arcFilter_.set(itSinkArcs->second, false);
+	}
+	superSink_ = fg.node(base_.findOutgoingId("#SUPERSINK"));
+}
+
+void
+LabelGraph::reset() {
+	for(std::vector<Node>::iterator itHidden = hiddenNodes_.begin();
+		itHidden != hiddenNodes_.end();
+		++itHidden) {
+		nodeFilter_.set(*itHidden, true);
+	}
+	hiddenNodes_.clear();
+	capacities_.clear();
+	condensed_.clear();
+}
+
+void
+LabelGraph::pruneFlowGraph(const std::string& name1, const std::set<std::string>& names) {
+	TimeScope scope(tm_, "prune graph");
+	Node source = fg.node(base_.findOutgoingId(name1));
+	Node superSink = superSink_;
+	source_ = source;
+	disableSinkArcs();
+	enableSinkArcs(names);
+	sinkGroup_ = -1;
+
+	std::vector<char> fromSource, toSink;
+	markReachable(source, false, fromSource);
+	markReachable(superSink, true, toSink);
+
+	for(LabelDigraph::NodeIt v(view_); v != INVALID; ++v) {
+		if (!fromSource[fg.id(v)] || !toSink[fg.id(v)])
+			hiddenNodes_.push_back(v);
+	}
+
+	hideNodes();
+	if (!sourceKept())
+		return;
+	compactGraphFromDominators();
+}
+
+void
+LabelGraph::pruneFlowGraph(const LabelReachability& reachability, int label) {
+	TimeScope scope(tm_, "prune graph");
+	source_ = fg.node(base_.findOutgoingId(reachability.getSourceName(label)));
+	// labels with the same sink set share the super sink arcs
+	if (reachability.getGroup(label) != sinkGroup_) {
+		disableSinkArcs();
+		enableSinkArcs(reachability.getSinkNames(label));
+		sinkGroup_ = reachability.getGroup(label);
+	}
+
+	for(LabelDigraph::NodeIt v(view_); v != INVALID; ++v) {
+		if (!reachability.keep(label, v))
+			hiddenNodes_.push_back(v);
+	}
+
+	hideNodes();
+	if (!sourceKept())
+		return;
+	compactGraphFromDominators();
+}
+
+void
+LabelGraph::disableSinkArcs() {
+	for(std::vector<Arc>::iterator itSinkArcs = enabledSinkArcs_.begin();
+		itSinkArcs != enabledSinkArcs_.end();
+		++itSinkArcs) {
+		arcFilter_.set(*itSinkArcs, false);
+	}
+	enabledSinkArcs_.clear();
+}
+
+void
+LabelGraph::enableSinkArcs(const std::set<std::string>& names) {
+	for(std::set<std::string>::const_iterator itIncompatibleNames = names.begin();
+	itIncompatibleNames != names.end();
+	++itIncompatibleNames) {
+		std::map<Symbol, Arc>::const_iterator itSinkArc = base_.frozenSuperSinkArcs_.find(base_.findSymbol(*itIncompatibleNames));
+		if (itSinkArc != base_.frozenSuperSinkArcs_.end()) {
+			arcFilter_.set(itSinkArc->second, true);
+			enabledSinkArcs_.push_back(itSinkArc->second);
+		}
+	}
+}
+
+void
+LabelGraph::markReachable(const Node& start, bool backward, std::vector<char>& reached) const {
+	reached.assign(fg.maxNodeId() + 1, 0);
+	if (start == INVALID)
+		return;
+	std::vector<Node> stack(1, start);
+	reached[fg.id(start)] = 1;
+	while (!stack.empty()) {
+		Node v = stack.back();
+		stack.pop_back();
+		if (backward) {
+			for(LabelDigraph::InArcIt e(view_, v); e != INVALID; ++e) {
+				Node u = view_.source(e);
+				if (!reached[fg.id(u)]) {
+					reached[fg.id(u)] = 1;
+					stack.push_back(u);
+				}
+			}
+		}
+		else {
+			for(LabelDigraph::OutArcIt e(view_, v); e != INVALID; ++e) {
+				Node u = view_.target(e);
+				if (!reached[fg.id(u)]) {
+					reached[fg.id(u)] = 1;
+					stack.push_back(u);
+				}
+			}
+		}
+	}
+}
+
+void
+LabelGraph::hideNodes() {
+	// hide only after the scan so the iteration before sees a stable view
+	for(std::vector<Node>::iterator itHidden = hiddenNodes_.begin();
+		itHidden != hiddenNodes_.end();
+		++itHidden) {
+		nodeFilter_.set(*itHidden, false);
+	}
+}
+
+void
+LabelGraph::compactGraphFromDominators() {
+	if (!sourceKept())
+		return;
+	std::map< Node, Node> idoms;
+	FastDominators<LabelDigraph> fd;
+	tm_.start("compute dominators");
+	fd.computeImmediateDominatorsFast(view_, source_, idoms);
+	tm_.stop("compute dominators");
+	tm_.start("compact graph");
+	compactGraphFromImmediateDominators(idoms);
+	tm_.stop("compact graph");
+}
+
+void
+LabelGraph::condenseFlowGraph() {
+	TimeScope scope(tm_, "condense graph");
+
+	if (!sourceKept()) {
+		// a source and a sink with nothing between them: the cut is empty
+		condensed_.clear();
+		condensedSource_ = condensed_.addNode();
+		condensedSink_ = condensed_.addNode();
+		if (warmStart_) {
+			componentOf_.assign(fg.maxNodeId() + 1, INVALID);
+			condensedArcOf_.assign(fg.maxArcId() + 1, INVALID);
+		}
+		return;
+	}
+
+	// infinite arcs can never be cut, so a cycle of them always ends up on
+	// one side of the cut and may as well be a single node
+	std::vector<int> component;
+	int numComponents = infiniteComponents(component);
+
+	condensed_.clear();
+	condensed_.reserveNode(numComponents);
+	std::vector<FlowGraph::Node> componentNodes(numComponents);
+	for(int c = 0; c < numComponents; ++c) {
+		componentNodes[c] = condensed_.addNode();
+	}
+
+	if (warmStart_) {
+		componentOf_.assign(fg.maxNodeId() + 1, INVALID);
+		condensedArcOf_.assign(fg.maxArcId() + 1, INVALID);
+		for(LabelDigraph::NodeIt v(view_); v != INVALID; ++v) {
+			componentOf_[fg.id(v)] = componentNodes[component[fg.id(v)]];
+		}
+	}
+
+	for(LabelDigraph::ArcIt e(view_); e != INVALID; ++e) {
+		int sourceComponent = component[fg.id(view_.source(e))];
+		int targetComponent = component[fg.id(view_.target(e))];
+		if (sourceComponent == targetComponent)
+			continue;
+		FlowGraph::Arc a = condensed_.addArc(componentNodes[sourceComponent], componentNodes[targetComponent]);
+		condensedCapacities_[a] = capacities_[e];
+		condensedOrigin_[a] = e;
+		if (warmStart_)
+			condensedArcOf_[fg.id(e)] = a;
+	}
+
+	condensedSource_ = componentNodes[component[fg.id(source_)]];
+	condensedSink_ = componentNodes[component[fg.id(superSink_)]];
+}
+
+// the strongly connected components of the view's infinite arcs, numbered
+// as lemon::stronglyConnectedComponents numbers them: a DFS records the
+// order nodes are left in, then a reverse DFS from the last one left
+// collects a component at a time
+int
+LabelGraph::infiniteComponents(std::vector<int>& component) const {
+	std::vector<char> infinite(fg.maxArcId() + 1, 0);
+	for(LabelDigraph::ArcIt e(view_); e != INVALID; ++e) {
+		infinite[fg.id(e)] = capacities_[e] >= SimpGraph::INFINITY_HACK;
+	}
+
+	std::vector<char> visited(fg.maxNodeId() + 1, 0);
+	std::vector<Node> leaveOrder;
+	std::vector< std::pair<Node, LabelDigraph::OutArcIt> > stack;
+	for(LabelDigraph::NodeIt r(view_); r != INVALID; ++r) {
+		if (visited[fg.id(r)])
+			continue;
+		visited[fg.id(r)] = 1;
+		stack.push_back(std::make_pair(Node(r), LabelDigraph::OutArcIt(view_, r)));
+		while (!stack.empty()) {
+			LabelDigraph::OutArcIt& e = stack.back().second;
+			if (e == INVALID) {
+				leaveOrder.push_back(stack.back().first);
+				stack.pop_back();
+				continue;
+			}
+			Node u = view_.target(e);
+			bool follow = infinite[fg.id(e)] && !visited[fg.id(u)];
+			++e;
+			if (follow) {
+				visited[fg.id(u)] = 1;
+				stack.push_back(std::make_pair(u, LabelDigraph::OutArcIt(view_, u)));
+			}
+		}
+	}
+
+	component.assign(fg.maxNodeId() + 1, -1);
+	int numComponents = 0;
+	std::vector<Node> pending;
+	for(std::vector<Node>::reverse_iterator itLeave = leaveOrder.rbegin(); itLeave != leaveOrder.rend(); ++itLeave) {
+		if (component[fg.id(*itLeave)] >= 0)
+			continue;
+		component[fg.id(*itLeave)] = numComponents;
+		pending.push_back(*itLeave);
+		while (!pending.empty()) {
+			Node v = pending.back();
+			pending.pop_back();
+			for(LabelDigraph::InArcIt e(view_, v); e != INVALID; ++e) {
+				Node u = view_.source(e);
+				if (infinite[fg.id(e)] && component[fg.id(u)] < 0) {
+					component[fg.id(u)] = numComponents;
+					pending.push_back(u);
+				}
+			}
+		}
+		++numComponents;
+	}
+	return numComponents;
+}
+
+void
+LabelGraph::performMinimumCut(std::ostream& os) {
+	CapMap seed(condensed_, 0);
+	seededFlow_ = warmStart_ ? seedFlow(seed) : 0;
+
+	if (flowEngine_ == UNIT_CAPACITY_ENGINE) {
+		UnitFlowType uft(condensed_, condensedCapacities_, condensedSource_, condensedSink_);
+		tm_.start("minimum cut");
+		if (warmStart_)
+			uft.init(seed);
+		else
+			uft.init();
+		uft.start();
+		tm_.stop("minimum cut");
+		flowValue_ = uft.flowValue();
+		tm_.start("report cut");
+		reportMinimumCut(uft, os);
+		tm_.stop("report cut");
+		if (warmStart_)
+			rememberFlowPaths(uft);
+	}
+	else {
+		PreflowType pft(condensed_, condensedCapacities_, condensedSource_, condensedSink_);
+		tm_.start("minimum cut");
+		if (warmStart_)
+			pft.init(seed);
+		else
+			pft.init();
+		pft.startFirstPhase();
+		pft.startSecondPhase();
+		tm_.stop("minimum cut");
+		flowValue_ = pft.flowValue();
+		tm_.start("report cut");
+		reportMinimumCut(pft, os);
+		tm_.stop("report cut");
+		if (warmStart_)
+			rememberFlowPaths(pft);
+	}
+}
+
+int
+LabelGraph::seedFlow(CapMap& seed) {
+	// replay each remembered path from the last of its nodes that falls in
+	// this label's source component, as long as the rest of it still runs
+	// through this label's condensed graph and has capacity left
+	int seeded = 0;
+	std::vector<FlowGraph::Arc> arcs;
+	for(std::vector< std::vector<Arc> >::iterator itPaths = flowPaths_.begin();
+		itPaths != flowPaths_.end();
+		++itPaths) {
+		const std::vector<Arc>& path = *itPaths;
+		int start = -1;
+		for(size_t k = 0; k < path.size(); ++k) {
+			if (componentOf_[fg.id(fg.source(path[k]))] == condensedSource_)
+				start = k;
+		}
+		if (start < 0)
+			continue;
+
+		arcs.clear();
+		bool valid = true;
+		FlowGraph::Node at = condensedSource_;
+		for(size_t k = start; k < path.size() && valid; ++k) {
+			FlowGraph::Node from = componentOf_[fg.id(fg.source(path[k]))];
+			FlowGraph::Node to = componentOf_[fg.id(fg.target(path[k]))];
+			if (from != at || to == INVALID) {
+				valid = false;
+			}
+			else if (from != to) {
+				// arcs inside a component are implied by its infinite cycle
+				FlowGraph::Arc a = condensedArcOf_[fg.id(path[k])];
+				if (a == INVALID)
+					valid = false;
+				else
+					arcs.push_back(a);
+			}
+			at = to;
+		}
+		if (!valid || at != condensedSink_)
+			continue;
+
+		for(size_t k = 0; k < arcs.size(); ++k) {
+			++seed[arcs[k]];
+		}
+		for(size_t k = 0; k < arcs.size(); ++k) {
+			if (seed[arcs[k]] > condensedCapacities_[arcs[k]])
+				valid = false;
+		}
+		if (valid) {
+			++seeded;
+		}
+		else {
+			for(size_t k = 0; k < arcs.size(); ++k) {
+				--seed[arcs[k]];
+			}
+		}
+	}
+	return seeded;
+}
+
+template<class FlowType>
+void
+LabelGraph::rememberFlowPaths(const FlowType& flow) {
+	// peel unit source-to-sink paths off the flow; a walk that comes back to
+	// a node already on it has found a flow cycle, which is cancelled
+	flowPaths_.clear();
+	CapMap remaining(condensed_);
+	for(FlowGraph::ArcIt e(condensed_); e != INVALID; ++e) {
+		remaining[e] = flow.flowMap()[e];
+	}
+	FlowGraph::NodeMap<int> onPath(condensed_, -1);
+	std::vector<FlowGraph::Arc> path;
+	std::vector<FlowGraph::Node> nodes;
+
+	for(int unit = 0; unit < flow.flowValue(); ++unit) {
+		path.clear();
+		nodes.assign(1, condensedSource_);
+		onPath[condensedSource_] = 0;
+		while (nodes.back() != condensedSink_) {
+			FlowGraph::OutArcIt e(condensed_, nodes.back());
+			while (e != INVALID && remaining[e] <= 0)
+				++e;
+			if (e == INVALID)
+				break;
+
+			FlowGraph::Node v = condensed_.target(e);
+			path.push_back(e);
+			if (onPath[v] >= 0) {
+				int j = onPath[v];
+				for(size_t k = j; k < path.size(); ++k) {
+					--remaining[path[k]];
+				}
+				for(size_t k = j + 1; k < nodes.size(); ++k) {
+					onPath[nodes[k]] = -1;
+				}
+				path.resize(j);
+				nodes.resize(j + 1);
+			}
+			else {
+				onPath[v] = nodes.size();
+				nodes.push_back(v);
+			}
+		}
+
+		for(size_t k = 0; k < nodes.size(); ++k) {
+			onPath[nodes[k]] = -1;
+		}
+		if (nodes.back() != condensedSink_)
+			break;
+
+		flowPaths_.push_back(std::vector<Arc>());
+		for(size_t k = 0; k < path.size(); ++k) {
+			--remaining[path[k]];
+			flowPaths_.back().push_back(condensedOrigin_[path[k]]);
+		}
+	}
+}
+
+template<class FlowType>
+void
+LabelGraph::reportMinimumCut(const FlowType& pft, std::ostream& os) {
+	if (pft.flowValue() > 0) {
+		if (!dotFile_.empty()) {
+			// labels may be cut concurrently; keep the dump from interleaving
+			std::lock_guard<std::mutex> lock(dotFileMutex);
+			outputToFile(dotFile_);
+		}
+		os << "flow value " << pft.flowValue() << std::endl;
+
+		CutMap sourceSide(condensed_);
+		residualSourceSide(condensed_, condensedCapacities_, pft.flowMap(), condensedSource_, sourceSide);
+
+		std::multimap<std::string, std::string> positionAndNVMap;
+		int maxLength = 0;
+
+		for(FlowGraph::ArcIt e(condensed_); e != INVALID; ++e) {
+			if (sourceSide[condensed_.source(e)] && !sourceSide[condensed_.target(e)]) {
+				// report the original arc, not the merged component
+				Node source = view_.source(condensedOrigin_[e]);
+				Node target = view_.target(condensedOrigin_[e]);
+				Symbol sourceName = base_.getSymbolForId(fg.id(source));
+				Symbol targetName = base_.getSymbolForId(fg.id(target));
+				// a cut arc is normally a name's in -> out arc, so one fetch
+				// gives both strings
+				std::string posString, asString;
+				base_.getMetadataForSymbol(targetName, posString, asString);
+				if (sourceName != targetName) {
+					std::string sourcePosition;
+					base_.getMetadataForSymbol(sourceName, sourcePosition, asString);
+				}
+				positionAndNVMap.insert(std::pair<std::string, std::string>(posString, asString + " ("+ base_.getSymbols().str(sourceName) + ")"));
+				maxLength = std::max(maxLength, (int) posString.length());
+			}
+		}
+
+		for(std::multimap<std::string, std::string>::iterator itPositionAndNVMap = positionAndNVMap.begin();
+			itPositionAndNVMap != positionAndNVMap.end();
+			++itPositionAndNVMap) {
+			os << std::left << std::setw(maxLength + 2) << itPositionAndNVMap->first << ": " << itPositionAndNVMap->second << std::endl;
+		}
+	}
+}
+
+void
+LabelGraph::compactGraphFromImmediateDominators(std::map< Node, Node>& idoms)
+{
+	DominatorTree<LabelDigraph> domTree(view_);
+	domTree.build(source_, idoms);
+	pruneGraphFromDominators(domTree);
+}
+
+void
+LabelGraph::pruneGraphFromDominators(const DominatorTree<LabelDigraph>& domTree) {
+	// a declassifier that dominates another declassifier is never needed in
+	// the cut, so its split arc is made uncuttable.  counting declassifiers
+	// per preorder prefix answers "is there another one in my subtree" in O(1)
+	int n = domTree.size();
+	std::vector<int> declBefore(n + 1, 0);
+	for(int i = 0; i < n; ++i) {
+		bool decl = base_.declIds.find(fg.id(domTree.nodeAt(i))) != base_.declIds.end();
+		declBefore[i + 1] = declBefore[i] + (decl ? 1 : 0);
+	}
+
+	for(int i = 0; i < n; ++i) {
+		if (declBefore[i + 1] == declBefore[i])
+			continue;
+		const Node& d = domTree.nodeAt(i);
+		if (declBefore[domTree.subtreeEnd(d)] - declBefore[i] > 1) {
+			for(LabelDigraph::OutArcIt outgoingFromDominators(view_, d);
+			outgoingFromDominators != INVALID;
+			++outgoingFromDominators) {
+				capacities_.set(outgoingFromDominators, SimpGraph::INFINITY_HACK);
+			}
+		}
+	}
+}
+
+void
+LabelGraph::outputToFile(const std::string& fileName) {
+	std::ofstream os(fileName.c_str());
+
+	os << "digraph G {" << std::endl;
+	for(LabelDigraph::NodeIt v(view_); v != INVALID; ++v) {
+		os << "\tnode" << fg.id(v) << " [label=\"" << base_.getNameForId(fg.id(v)) << "\"]" << std::endl;
+	}
+	for(LabelDigraph::ArcIt e(view_); e != INVALID; ++e) {
+		Node source = view_.source(e);
+		Node target = view_.target(e);
+		os << "\tnode" << fg.id(source) << " -> node" << fg.id(target) << " [label=\"" << capacities_[e] << "\"]" << std::endl;
+	}
+	os << "}" << std::endl;
+
+	os.close();
+}
+
+void
+LabelGraph::getCondensedStats(GraphStats& graphStats) {
+	graphStats.num_nodes = countNodes(condensed_);
+	graphStats.num_edges = countArcs(condensed_);
+}
+
+void
+LabelGraph::getStats(GraphStats& graphStats) {
+	int nodes = 0;
+	int edges = 0;
+	for(LabelDigraph::NodeIt n(view_); n != INVALID; ++n) {
+		nodes++;
+	}
+	for(LabelDigraph::ArcIt e(view_); e != INVALID; ++e) {
+		edges++;
+	}
+	graphStats.num_nodes = nodes;
+	graphStats.num_edges = edges;
+}
@@ -0,0 +1,173 @@
+#pragma once
+#include <lemon/adaptors.h>
+#include "SimpGraph.h"
+#include "TimeManager.h"
+#include "GraphStats.h"
+#include "DominatorTree.h"
+#include "UnitCapacityFlow.h"
+
+#include <string>
+#include <set>
+#include <map>
+#include <vector>
+#include <iostream>
+
+class LabelReachability;
+
+// capacities of the base graph with a sparse set of per-label overrides
+class OverlayCapMap {
+
+public:
+  typedef FrozenGraph::Arc Key;
+  typedef int Value;
+
+  OverlayCapMap(const FrozenCapMap& base) : base_(base) { }
+
+  Value operator[](const Key& arc) const {
+    std::map<Key, int>::const_iterator itOverride = overrides_.find(arc);
+    if (itOverride != overrides_.end())
+      return itOverride->second;
+    return base_[arc];
+  }
+  void set(const Key& arc, const Value& value) { overrides_[arc] = value; }
+  void clear() { overrides_.clear(); }
+
+protected:
+  const FrozenCapMap& base_;
+  std::map<Key, int> overrides_;
+};
+
+// a flag per node or arc of the frozen graph, indexed by its id.  a graph
+// map would register with the shared base graph's notifier, which LEMON
+// only locks when built with threads; this one leaves the base graph alone,
+// so every worker can keep its own.
+template<class Item>
+class FrozenFilter {
+
+public:
+  typedef Item Key;
+  typedef bool Value;
+
+  FrozenFilter(const FrozenGraph& graph, int size, bool value) : graph_(graph), values_(size, value) { }
+
+  Value operator[](const Key& item) const { return values_[graph_.id(item)] != 0; }
+  void set(const Key& item, const Value& value) { values_[graph_.id(item)] = value; }
+
+protected:
+  const FrozenGraph& graph_;
+  std::vector<char> values_;
+};
+
+typedef FrozenFilter<FrozenGraph::Node> NodeFilter;
+typedef FrozenFilter<FrozenGraph::Arc> ArcFilter;
+typedef SubDigraph<const FrozenGraph, NodeFilter, ArcFilter> LabelDigraph;
+typedef Preflow<LabelDigraph, OverlayCapMap> LabelPreflowType;
+typedef UnitCapacityFlow<FlowGraph, CapMap> UnitFlowType;
+
+// which max-flow solver performMinimumCut runs on the condensed graph
+enum FlowEngine {
+  PREFLOW_ENGINE,
+  UNIT_CAPACITY_ENGINE
+};
+
+// the analysis of one lattice label as a view over a frozen SimpGraph.  the
+// base graph and its name metadata are shared read-only; only the label's
+// super sink arcs, the pruned nodes and the dominator capacity overrides
+// are recorded here.  reset() undoes the pruning and the overrides so one
+// view can be reused for label after label; the sink arcs are switched by
+// the next prune, and only when its sink set differs.  nodes and arcs are those of the frozen
+// CSR image, whose node ids are the SimpGraph ids.  nothing here attaches a
+// map to the shared base graph: per-label state is kept in vectors indexed
+// by id, so workers can analyse labels concurrently.
+class LabelGraph {
+
+public:
+  typedef FrozenGraph::Node Node;
+  typedef FrozenGraph::Arc Arc;
+
+protected:
+  const SimpGraph& base_;
+  const FrozenGraph& fg;
+  TimeManager& tm_;
+
+  NodeFilter nodeFilter_;
+  ArcFilter arcFilter_;
+  LabelDigraph view_;
+  OverlayCapMap capacities_;
+
+  std::vector<Node> hiddenNodes_;
+  std::vector<Arc> enabledSinkArcs_;
+  int sinkGroup_;                 // LabelReachability group they belong to, -1 if none
+  Node source_;
+  Node superSink_;
+
+  // the pruned view with every strongly connected component of its
+  // infinite-capacity arcs merged into one node.  each condensed arc keeps
+  // the base arc it came from so cuts are reported in terms of names.
+  FlowGraph condensed_;
+  CapMap condensedCapacities_;
+  FlowGraph::ArcMap<Arc> condensedOrigin_;
+  FlowGraph::Node condensedSource_;
+  FlowGraph::Node condensedSink_;
+
+  FlowEngine flowEngine_;
+  std::string dotFile_;           // where a cut label's graph is dumped, none if empty
+
+  // warm start: the last cut label's flow as unit paths of base arcs, and
+  // where this label's condensation put every base node and arc, so the
+  // paths can be replayed as the starting flow of the next label
+  bool warmStart_;
+  std::vector< std::vector<Arc> > flowPaths_;
+  std::vector<FlowGraph::Node> componentOf_;
+  std::vector<FlowGraph::Arc> condensedArcOf_;
+  int flowValue_;
+  int seededFlow_;
+
+  int seedFlow(CapMap& seed);
+
+  // false once pruning has hidden the label's source, which happens when it
+  // reaches none of its sinks; there is then nothing to compact or cut
+  bool sourceKept() const { return source_ != INVALID && nodeFilter_[source_]; }
+
+  void disableSinkArcs();
+  void enableSinkArcs(const std::set<std::string>& names);
+  void hideNodes();
+  void markReachable(const Node& start, bool backward, std::vector<char>& reached) const;
+  int infiniteComponents(std::vector<int>& component) const;
+  void compactGraphFromDominators();
+  void compactGraphFromImmediateDominators(std::map< Node, Node>& idoms);
+  void pruneGraphFromDominators(const DominatorTree<LabelDigraph>& domTree);
+  void outputToFile(const std::string& fileName);
+
+  template<class FlowType>
+  void reportMinimumCut(const FlowType& flow, std::ostream& os);
+  template<class FlowType>
+  void rememberFlowPaths(const FlowType& flow);
+
+public:
+  LabelGraph(const SimpGraph& base, TimeManager& tm);
+
+  const LabelDigraph& getLabelDigraph() const { return view_; }
+  const FlowGraph& getCondensedGraph() const { return condensed_; }
+  const CapMap& getCondensedCapacities() const { return condensedCapacities_; }
+  FlowGraph::Node getCondensedSource() const { return condensedSource_; }
+  FlowGraph::Node getCondensedSink() const { return condensedSink_; }
+
+  void setFlowEngine(FlowEngine flowEngine) { flowEngine_ = flowEngine; }
+  void setWarmStart(bool warmStart) { warmStart_ = warmStart; }
+  void setDotFile(const std::string& dotFile) { dotFile_ = dotFile; }
+
+  // of the last minimum cut: its flow value and how many units of it were
+  // replayed from the previous label instead of being searched for
+  int getFlowValue() const { return flowValue_; }
+  int getSeededFlow() const { return seededFlow_; }
+
+  void pruneFlowGraph(const std::string& name1, const std::set<std::string>& names);
+  // the same pruning, read off keep sets computed for all labels at once
+  void pruneFlowGraph(const LabelReachability& reachability, int label);
+  void condenseFlowGraph();
+  void performMinimumCut(std::ostream& os = std::cout);
+  void getStats(GraphStats& graphStats);
+  void getCondensedStats(GraphStats& graphStats);
+  void reset();
+};
@@ -0,0 +1,195 @@
+#include "LabelReachability.h"
+
+LabelReachability::LabelReachability(const SimpGraph& base) :
+	base_(base), fg(base.getFrozenGraph()), labelWords_(0), groupWords_(0), numComponents_(0) {
+	superSink_ = base_.findOutgoingId("#SUPERSINK");
+}
+
+int
+LabelReachability::addLabel(const std::string& source, const std::set<std::string>& sinks) {
+	sourceNames_.push_back(source);
+	sources_.push_back(base_.findOutgoingId(source));
+
+	std::map<std::set<std::string>, int>::iterator itGroup = groupIds_.find(sinks);
+	if (itGroup == groupIds_.end()) {
+		itGroup = groupIds_.insert(std::make_pair(sinks, (int) groupSinks_.size())).first;
+		groupSinkNames_.push_back(sinks);
+		groupSinks_.push_back(std::vector<int>());
+		for(std::set<std::string>::const_iterator itSinks = sinks.begin();
+			itSinks != sinks.end();
+			++itSinks) {
+			int id = base_.findOutgoingId(*itSinks);
+			if (id >= 0)
+				groupSinks_.back().push_back(id);
+		}
+	}
+	group_.push_back(itGroup->second);
+	return sources_.size() - 1;
+}
+
+void
+LabelReachability::findComponents(const std::vector<int>& first, const std::vector<int>& succ) {
+	// Tarjan's algorithm with an explicit stack.  a component is numbered
+	// when it is finished, which is after everything it reaches, so arcs
+	// between components always go from a higher number to a lower one
+	int n = first.size() - 1;
+	std::vector<int> index(n, -1);
+	std::vector<int> low(n, 0);
+	std::vector<int> nextArc(first.begin(), first.end() - 1);
+	std::vector<int> sccStack;
+	std::vector<int> callStack;
+	int counter = 0;
+
+	component_.assign(n, -1);
+	numComponents_ = 0;
+	for(int s = 0; s < n; ++s) {
+		if (s == superSink_ || index[s] >= 0)
+			continue;
+		index[s] = low[s] = counter++;
+		sccStack.push_back(s);
+		callStack.push_back(s);
+		while (!callStack.empty()) {
+			int v = callStack.back();
+			if (nextArc[v] < first[v + 1]) {
+				int w = succ[nextArc[v]++];
+				if (w == superSink_)
+					continue;
+				if (index[w] < 0) {
+					index[w] = low[w] = counter++;
+					sccStack.push_back(w);
+					callStack.push_back(w);
+				}
+				else if (component_[w] < 0 && index[w] < low[v]) {
+					low[v] = index[w];
+				}
+				continue;
+			}
+
+			callStack.pop_back();
+			if (low[v] == index[v]) {
+				int w;
+				do {
+					w = sccStack.back();
+					sccStack.pop_back();
+					component_[w] = numComponents_;
+				} while (w != v);
+				++numComponents_;
+			}
+			if (!callStack.empty() && low[v] < low[callStack.back()])
+				low[callStack.back()] = low[v];
+		}
+	}
+}
+
+void
+LabelReachability::run() {
+	// successors of every node as plain arrays; the frozen graph already
+	// groups its arcs by source, so this is a single sequential sweep
+	int n = countNodes(fg);
+	std::vector<int> first(n + 1, 0);
+	for(FrozenGraph::ArcIt e(fg); e != INVALID; ++e) {
+		++first[fg.id(fg.source(e)) + 1];
+	}
+	for(int v = 0; v < n; ++v) {
+		first[v + 1] += first[v];
+	}
+	std::vector<int> succ(first[n]);
+	std::vector<int> fill(first.begin(), first.end() - 1);
+	for(FrozenGraph::ArcIt e(fg); e != INVALID; ++e) {
+		succ[fill[fg.id(fg.source(e))]++] = fg.id(fg.target(e));
+	}
+
+	findComponents(first, succ);
+
+	// members of every component, so a pass can visit components in order
+	std::vector<int> firstMember(numComponents_ + 1, 0);
+	for(int v = 0; v < n; ++v) {
+		if (component_[v] >= 0)
+			++firstMember[component_[v] + 1];
+	}
+	for(int c = 0; c < numComponents_; ++c) {
+		firstMember[c + 1] += firstMember[c];
+	}
+	std::vector<int> members(firstMember[numComponents_]);
+	std::vector<int> fillMember(firstMember.begin(), firstMember.end() - 1);
+	for(int v = 0; v < n; ++v) {
+		if (component_[v] >= 0)
+			members[fillMember[component_[v]]++] = v;
+	}
+
+	int numLabels = sources_.size();
+	int numGroups = groupSinks_.size();
+	labelWords_ = (numLabels + WORD_BITS - 1) / WORD_BITS;
+	groupWords_ = (numGroups + WORD_BITS - 1) / WORD_BITS;
+	forward_.assign(numComponents_ * labelWords_, 0);
+	backward_.assign(numComponents_ * groupWords_, 0);
+	for(int label = 0; label < numLabels; ++label) {
+		if (sources_[label] >= 0)
+			forward_[component_[sources_[label]] * labelWords_ + label / WORD_BITS] |= Word(1) << (label % WORD_BITS);
+	}
+	for(int group = 0; group < numGroups; ++group) {
+		for(std::vector<int>::iterator itSinks = groupSinks_[group].begin();
+			itSinks != groupSinks_[group].end();
+			++itSinks) {
+			backward_[component_[*itSinks] * groupWords_ + group / WORD_BITS] |= Word(1) << (group % WORD_BITS);
+		}
+	}
+
+	// the word loops below are plain enough for the compiler to vectorise
+	for(int c = numComponents_ - 1; c >= 0; --c) {
+		const Word* from = &forward_[c * labelWords_];
+		for(int m = firstMember[c]; m < firstMember[c + 1]; ++m) {
+			int v = members[m];
+			for(int i = first[v]; i < first[v + 1]; ++i) {
+				int d = succ[i] == superSink_ ? c : component_[succ[i]];
+				if (d == c)
+					continue;
+				Word* to = &forward_[d * labelWords_];
+				for(int w = 0; w < labelWords_; ++w)
+					to[w] |= from[w];
+			}
+		}
+	}
+	for(int c = 0; c < numComponents_; ++c) {
+		Word* to = &backward_[c * groupWords_];
+		for(int m = firstMember[c]; m < firstMember[c + 1]; ++m) {
+			int v = members[m];
+			for(int i = first[v]; i < first[v + 1]; ++i) {
+				int d = succ[i] == superSink_ ? c : component_[succ[i]];
+				if (d == c)
+					continue;
+				const Word* from = &backward_[d * groupWords_];
+				for(int w = 0; w < groupWords_; ++w)
+					to[w] |= from[w];
+			}
+		}
+	}
+}
+
+void
+LabelReachability::planOrder(std::vector<int>& order) const {
+	std::vector< std::vector<int> > byGroup(groupSinks_.size());
+	for(int label = 0; label < (int) group_.size(); ++label) {
+		byGroup[group_[label]].push_back(label);
+	}
+	order.clear();
+	for(size_t group = 0; group < byGroup.size(); ++group) {
+		order.insert(order.end(), byGroup[group].begin(), byGroup[group].end());
+	}
+}
+
+bool
+LabelReachability::reachesSink(int label) const {
+	if (sources_[label] < 0)
+		return false;
+	return hasBit(backward_, groupWords_, component_[sources_[label]], group_[label]);
+}
+
+bool
+LabelReachability::keep(int label, const FrozenGraph::Node& v) const {
+	int id = fg.id(v);
+	if (id == superSink_)
+		return reachesSink(label);
+	int c = component_[id];
+	return hasBit(forward_, labelWords_, c, label) && hasBit(backward_, groupWords_, c, group_[label]);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "SimpGraph.h"
+
+#include <string>
+#include <set>
+#include <vector>
+#include <map>
+
+// the nodes every label's analysis keeps, for all labels at once.  a label
+// keeps the nodes reachable from its LATTICE# node that also reach one of
+// its incomparable labels.  both halves are propagated as bit masks over
+// the strongly connected components of the frozen graph: sources forward in
+// topological order with a bit per label, sink sets backward in reverse
+// with a bit per group of labels sharing the same sink set, so the graph is
+// walked twice in total instead of twice a label.
+class LabelReachability {
+
+protected:
+	typedef unsigned long Word;
+	static const int WORD_BITS = sizeof(Word) * 8;
+
+	const SimpGraph& base_;
+	const FrozenGraph& fg;
+	int superSink_;
+
+	std::vector<std::string> sourceNames_;
+	std::vector<int> sources_;                      // label -> node id, -1 if absent
+	std::vector<int> group_;                        // label -> sink group
+
+	std::map<std::set<std::string>, int> groupIds_;
+	std::vector< std::set<std::string> > groupSinkNames_;
+	std::vector< std::vector<int> > groupSinks_;    // group -> node ids of its sinks
+
+	int labelWords_;
+	int groupWords_;
+	int numComponents_;
+	std::vector<int> component_;      // node id -> component, sinks first
+	std::vector<Word> forward_;       // component -> labels that reach it
+	std::vector<Word> backward_;      // component -> groups it reaches a sink of
+
+	bool hasBit(const std::vector<Word>& masks, int words, int c, int bit) const {
+		return (masks[c * words + bit / WORD_BITS] >> (bit % WORD_BITS)) & 1;
+	}
+
+	void findComponents(const std::vector<int>& first, const std::vector<int>& succ);
+
+public:
+	LabelReachability(const SimpGraph& base);
+
+	// returns the label's index; call for every label before run()
+	int addLabel(const std::string& source, const std::set<std::string>& sinks);
+	void run();
+
+	int numLabels() const { return sources_.size(); }
+	int numGroups() const { return groupSinks_.size(); }
+	int numComponents() const { return numComponents_; }
+	int getGroup(int label) const { return group_[label]; }
+	const std::string& getSourceName(int label) const { return sourceNames_[label]; }
+	const std::set<std::string>& getSinkNames(int label) const { return groupSinkNames_[group_[label]]; }
+
+	// the labels ordered group by group, so that consecutive labels share
+	// their sink arcs
+	void planOrder(std::vector<int>& order) const;
+
+	bool reachesSink(int label) const;
+	bool keep(int label, const FrozenGraph::Node& v) const;
+};
@@ -0,0 +1,72 @@
+#include "Lattice.h"
+
+#include <stdio.h>
+
+void
+Lattice::addLabel(const std::string& name, int id) {
+	labelIds_[name] = id;
+}
+
+void
+Lattice::addLeq(int lhs, int rhs) {
+	if (lhs > maxId_)
+		maxId_ = lhs;
+	if (rhs > maxId_)
+		maxId_ = rhs;
+	leqs_.push_back(std::pair<int,int>(lhs, rhs));
+}
+
+void
+Lattice::computeReachability() {
+	int n = maxId_ + 1;
+	words_ = (n + WORD_BITS - 1) / WORD_BITS;
+	reach_.assign(n * words_, 0);
+
+	for(int i = 0; i < n; ++i)
+		row(i)[i / WORD_BITS] |= Word(1) << (i % WORD_BITS);
+	for(std::vector< std::pair<int,int> >::const_iterator itLeqs = leqs_.begin();
+		itLeqs != leqs_.end();
+		++itLeqs) {
+		row(itLeqs->first)[itLeqs->second / WORD_BITS] |= Word(1) << (itLeqs->second % WORD_BITS);
+	}
+
+	// Warshall over bit rows: if i reaches k then i reaches everything k does
+	for(int k = 0; k < n; ++k) {
+		const Word* rowK = row(k);
+		for(int i = 0; i < n; ++i) {
+			Word* rowI = row(i);
+			if (rowI[k / WORD_BITS] & (Word(1) << (k % WORD_BITS))) {
+				for(int w = 0; w < words_; ++w)
+					rowI[w] |= rowK[w];
+			}
+		}
+	}
+}
+
+bool
+Lattice::leq(int i, int j) const {
+	return (row(i)[j / WORD_BITS] >> (j % WORD_BITS)) & 1;
+}
+
+void
+Lattice::getIncomparable(int i, std::set<int>& incomparable) const {
+	for(int j = 0; j <= maxId_; ++j) {
+		if (!leq(i, j))
+			incomparable.insert(j);
+	}
+}
+
+void
+Lattice::getIncomparableNames(int i, std::set<std::string>& incomparable) const {
+	for(int j = 0; j <= maxId_; ++j) {
+		if (!leq(i, j))
+			incomparable.insert(labelNodeName(j));
+	}
+}
+
+std::string
+Lattice::labelNodeName(int id) {
+	char buffer[16];
+	sprintf(buffer, "%d", id);
+	return "LATTICE#" + std::string(buffer);
+}
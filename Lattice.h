@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+
+// the security lattice read from <lattice>: collects <lt> edges while the
+// constraints stream in, then answers "which labels may label i not flow
+// to" from a bitset reachability matrix computed once.
+class Lattice {
+
+protected:
+	typedef unsigned long Word;
+	static const int WORD_BITS = sizeof(Word) * 8;
+
+	std::map<std::string, int> labelIds_;
+	std::vector< std::pair<int, int> > leqs_;
+	int maxId_;
+
+	int words_;
+	std::vector<Word> reach_;
+
+	Word* row(int i) { return &reach_[i * words_]; }
+	const Word* row(int i) const { return &reach_[i * words_]; }
+
+public:
+	Lattice() : maxId_(0), words_(0) { }
+
+	void addLabel(const std::string& name, int id);
+	void addLeq(int lhs, int rhs);
+
+	// reflexive-transitive closure of the <lt> edges; call once after parsing
+	void computeReachability();
+
+	int getMaxId() const { return maxId_; }
+	const std::map<std::string, int>& getLabelIds() const { return labelIds_; }
+	const std::vector< std::pair<int, int> >& getLeqs() const { return leqs_; }
+
+	bool leq(int i, int j) const;
+	void getIncomparable(int i, std::set<int>& incomparable) const;
+	void getIncomparableNames(int i, std::set<std::string>& incomparable) const;
+
+	static std::string labelNodeName(int id);
+};
@@ -0,0 +1,34 @@
+#include "MemoryUsage.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <sys/resource.h>
+
+MemoryUsage
+MemoryUsage::current(bool withHeap) {
+	MemoryUsage usage;
+
+	FILE* statm = fopen("/proc/self/statm", "r");
+	if (statm != NULL) {
+		long long size, resident;
+		if (fscanf(statm, "%lld %lld", &size, &resident) == 2)
+			usage.rss = resident * sysconf(_SC_PAGESIZE);
+		fclose(statm);
+	}
+
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru) == 0)
+		usage.peakRss = (long long) ru.ru_maxrss * 1024;
+
+	if (!withHeap)
+		return usage;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	struct mallinfo2 mi = mallinfo2();
+	usage.heap = mi.uordblks + mi.hblkhd;
+#elif defined(__GLIBC__)
+	struct mallinfo mi = mallinfo();
+	usage.heap = (unsigned int) mi.uordblks + (unsigned int) mi.hblkhd;
+#endif
+	return usage;
+}
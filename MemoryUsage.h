@@ -0,0 +1,19 @@
+#ifndef MEMORYUSAGE_H_
+#define MEMORYUSAGE_H_
+
+// a snapshot of the process's memory, in bytes.  rss comes from
+// /proc/self/statm, the peak from getrusage and, if asked for, the live
+// heap from the allocator's own statistics, which locks and walks every
+// malloc arena.  these are process-wide, so with several threads a phase
+// also sees what the others allocate meanwhile.
+struct MemoryUsage {
+	long long rss;
+	long long peakRss;
+	long long heap;
+
+	MemoryUsage() : rss(0), peakRss(0), heap(0) { }
+
+	static MemoryUsage current(bool withHeap);
+};
+
+#endif /*MEMORYUSAGE_H_*/
@@ -0,0 +1,70 @@
+#include "MetadataStore.h"
+
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+static bool
+readExtent(std::istream& is, const ElementExtent& extent, std::vector<char>& buffer, std::string& position, std::string& asString) {
+	buffer.assign(extent.length + 1, '\0');
+	is.clear();
+	is.seekg(extent.offset);
+	is.read(&buffer[0], extent.length);
+	if (is.gcount() != (std::streamsize) extent.length)
+		return false;
+
+	TiXmlDocument fragment;
+	fragment.Parse(&buffer[0]);
+	const TiXmlElement* con = fragment.FirstChildElement();
+	if (fragment.Error() || con == NULL)
+		return false;
+	return MetadataStore::readMetadata(*con, position, asString);
+}
+
+bool
+MetadataStore::readMetadata(const TiXmlElement& con, std::string& position, std::string& asString) {
+	const TiXmlElement* becauseElem = con.FirstChildElement("because");
+	const TiXmlElement* posElem = con.FirstChildElement("pos");
+	if (becauseElem == NULL || becauseElem->FirstChild() == NULL || posElem == NULL || posElem->FirstChild() == NULL)
+		return false;
+	asString = becauseElem->FirstChild()->Value();
+	position = posElem->FirstChild()->Value();
+	return true;
+}
+
+bool
+MetadataStore::fetch(Symbol name, std::string& position, std::string& asString) const {
+	std::map<Symbol, ElementExtent>::const_iterator itExtent = extents_.find(name);
+	if (itExtent == extents_.end())
+		return false;
+
+	std::ifstream is(fileName_.c_str(), std::ios::in | std::ios::binary);
+	std::vector<char> buffer;
+	return readExtent(is, itExtent->second, buffer, position, asString);
+}
+
+void
+MetadataStore::fetchAll(std::map<Symbol, std::string>& positions, std::map<Symbol, std::string>& asStrings) const {
+	// seeking only forward through one stream keeps this a sequential read
+	std::vector< std::pair<unsigned long long, Symbol> > order;
+	order.reserve(extents_.size());
+	for(std::map<Symbol, ElementExtent>::const_iterator itExtents = extents_.begin();
+		itExtents != extents_.end();
+		++itExtents) {
+		order.push_back(std::make_pair(itExtents->second.offset, itExtents->first));
+	}
+	std::sort(order.begin(), order.end());
+
+	std::ifstream is(fileName_.c_str(), std::ios::in | std::ios::binary);
+	std::vector<char> buffer;
+	std::string position, asString;
+	for(std::vector< std::pair<unsigned long long, Symbol> >::iterator itOrder = order.begin();
+		itOrder != order.end();
+		++itOrder) {
+		if (!readExtent(is, extents_.find(itOrder->second)->second, buffer, position, asString))
+			continue;
+		positions[itOrder->second] = position;
+		asStrings[itOrder->second] = asString;
+	}
+}
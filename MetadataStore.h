@@ -0,0 +1,32 @@
+#pragma once
+
+#include "ConstraintReader.h"
+#include "SymbolTable.h"
+
+#include <string>
+#include <map>
+
+// the position and asString of declassifier names, kept only as the extent
+// of the <con> element that carried them.  the strings are needed for the
+// few names that end up in a cut, so they are read back from the constraint
+// file when asked for.  lookups open their own stream and are thread safe.
+class MetadataStore {
+
+protected:
+	std::string fileName_;
+	std::map<Symbol, ElementExtent> extents_;
+
+public:
+	void setSource(const std::string& fileName) { fileName_ = fileName; }
+	void add(Symbol name, const ElementExtent& extent) { extents_[name] = extent; }
+	bool contains(Symbol name) const { return extents_.find(name) != extents_.end(); }
+	const std::map<Symbol, ElementExtent>& getExtents() const { return extents_; }
+
+	bool fetch(Symbol name, std::string& position, std::string& asString) const;
+	// every name's strings, from one pass over the file in offset order;
+	// names whose element can't be read back are left out
+	void fetchAll(std::map<Symbol, std::string>& positions, std::map<Symbol, std::string>& asStrings) const;
+
+	// the position and asString a <con> element records for its rhs
+	static bool readMetadata(const TiXmlElement& con, std::string& position, std::string& asString);
+};
@@ -0,0 +1,83 @@
+#include "PerfCounters.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+static int
+openCounter(unsigned int type, unsigned long long config, int groupFd) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = groupFd == -1 ? 1 : 0;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+PerfCounters::PerfCounters() : leader_(-1), numOpen_(0)
+{
+	static const unsigned long long configs[NUM_COUNTERS] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES
+	};
+	// one group, so all counters cover exactly the same instructions
+	for(int c = 0; c < NUM_COUNTERS; ++c) {
+		fd_[c] = openCounter(PERF_TYPE_HARDWARE, configs[c], leader_);
+		slot_[c] = -1;
+		if (fd_[c] < 0)
+			continue;
+		if (leader_ == -1)
+			leader_ = fd_[c];
+		slot_[c] = numOpen_++;
+	}
+	if (leader_ != -1) {
+		ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+}
+
+PerfCounters::~PerfCounters()
+{
+	for(int c = 0; c < NUM_COUNTERS; ++c) {
+		if (fd_[c] >= 0)
+			close(fd_[c]);
+	}
+}
+
+PerfCounters::Values
+PerfCounters::read() const {
+	Values values;
+	if (leader_ == -1)
+		return values;
+
+	// nr, time enabled, time running, then one value per counter
+	unsigned long long buffer[3 + NUM_COUNTERS];
+	ssize_t bytes = ::read(leader_, buffer, sizeof(buffer));
+	if (bytes < (ssize_t) (3 + numOpen_) * (ssize_t) sizeof(unsigned long long))
+		return values;
+
+	if (buffer[2] == 0)
+		return values;
+	double scale = (double) buffer[1] / buffer[2];
+	for(int c = 0; c < NUM_COUNTERS; ++c) {
+		if (slot_[c] < 0)
+			continue;
+		values.value[c] = (long long) (buffer[3 + slot_[c]] * scale);
+		values.mask |= 1 << c;
+	}
+	return values;
+}
+
+const char*
+PerfCounters::name(Counter c) {
+	static const char* names[NUM_COUNTERS] = { "cycles", "instructions", "LLC misses", "branch misses" };
+	return names[c];
+}
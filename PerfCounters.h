@@ -0,0 +1,46 @@
+#ifndef PERFCOUNTERS_H_
+#define PERFCOUNTERS_H_
+
+// hardware counters for the calling thread through perf_event_open.  each
+// counter that the kernel or the machine refuses is left out; if none can be
+// opened, available() is false and read() returns nothing.
+class PerfCounters
+{
+public:
+	enum Counter { CYCLES, INSTRUCTIONS, LLC_MISSES, BRANCH_MISSES, NUM_COUNTERS };
+
+	struct Values {
+		long long value[NUM_COUNTERS];
+		int mask;                    // bit c set if value[c] was measured
+
+		Values() : mask(0) { for(int c = 0; c < NUM_COUNTERS; ++c) value[c] = 0; }
+
+		bool has(Counter c) const { return (mask & (1 << c)) != 0; }
+	};
+
+protected:
+	int fd_[NUM_COUNTERS];
+	int leader_;
+	int numOpen_;
+	int slot_[NUM_COUNTERS];     // position in the group read, or -1
+
+private:
+	PerfCounters(const PerfCounters&);
+	PerfCounters& operator=(const PerfCounters&);
+
+public:
+	PerfCounters();
+	virtual ~PerfCounters();
+
+	bool available() const { return numOpen_ > 0; }
+	bool has(Counter c) const { return slot_[c] >= 0; }
+
+	// running totals since the counters were opened, scaled up if the
+	// kernel had to multiplex them.  if the group has not been scheduled
+	// on the cpu yet there is nothing to scale, and the mask is empty.
+	Values read() const;
+
+	static const char* name(Counter c);
+};
+
+#endif /*PERFCOUNTERS_H_*/
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <lemon/core.h>
+#include <vector>
+
+// marks the nodes reachable from source in the residual network of a
+// maximum flow -- the source side of the minimum cut -- by walking the
+// original arcs directly instead of building the residual graph
+template<class GR, class CAP, class FLOW, class CUT>
+void residualSourceSide(const GR& graph, const CAP& capacity, const FLOW& flow,
+                        const typename GR::Node& source, CUT& cut) {
+	typedef typename GR::Node Node;
+
+	for(typename GR::NodeIt v(graph); v != lemon::INVALID; ++v)
+		cut.set(v, false);
+
+	std::vector<Node> stack;
+	cut.set(source, true);
+	stack.push_back(source);
+	while (!stack.empty()) {
+		Node u = stack.back();
+		stack.pop_back();
+		for(typename GR::OutArcIt e(graph, u); e != lemon::INVALID; ++e) {
+			Node w = graph.target(e);
+			if (!cut[w] && flow[e] < capacity[e]) {
+				cut.set(w, true);
+				stack.push_back(w);
+			}
+		}
+		for(typename GR::InArcIt e(graph, u); e != lemon::INVALID; ++e) {
+			Node w = graph.source(e);
+			if (!cut[w] && flow[e] > 0) {
+				cut.set(w, true);
+				stack.push_back(w);
+			}
+		}
+	}
+}
@@ -2,15 +2,21 @@
 #include <lemon/lgf_reader.h> 
 #include <lemon/list_graph.h> 
 #include <lemon/smart_graph.h> 
+#include <lemon/static_graph.h>
 #include <lemon/concepts/digraph.h>
 #include <lemon/dfs.h> 
 #include <lemon/preflow.h>
 #include <lemon/elevator.h>
 #include "TimeManager.h"
 #include "GraphStats.h"
+#include "SymbolTable.h"
+#include "MetadataStore.h"
 
 #include <string>
 #include <set>
+#include <vector>
+#include <memory>
+#include <iostream>
 
 using namespace lemon;
 
@@ -29,69 +35,117 @@ typedef FlowGraph::NodeMap<std::string> NodeStringMap;
 
 typedef Preflow<FlowGraph,CapMap> PreflowType;
 
+// the read-only CSR image the per-label analysis runs on
+typedef StaticDigraph FrozenGraph;
+typedef FrozenGraph::ArcMap<int> FrozenCapMap;
+
 class SimpGraph {
 
 protected: 
-  FlowGraph fg;
+  // the list graph names and constraints are added to, with everything
+  // attached to it.  freeze() compiles it into the frozen image and resets
+  // it, so the base graph is held once; a graph loaded from a cache never
+  // has one.
+  struct Construction {
+    FlowGraph fg;
+    CapMap capacities;
+    // ids are handed out densely by nextId, so both directions are arrays
+    FlowGraph::NodeMap<int> nodeToId;
+    std::vector<Node> idToNode;
+    // arcs from each lattice label into #SUPERSINK; labels switch them on
+    std::map<Symbol, Arc> superSinkArcs;
+
+    Construction() : capacities(fg), nodeToId(fg, -1) { }
+  };
+  std::unique_ptr<Construction> list_;
+
   int nextId; 
-  CapMap fgCapacities;
   TimeManager& tm_;
 
-  typedef std::map<int, std::string> IdToNameMap;
-  typedef std::map<std::string, int> NameToIdMap;
-	
-  typedef std::map<Node, int> NodeToIdMap;
-  typedef std::map<int, Node> IdToNodeMap;
-
   std::set<int> declIds;
   std::set<int> expIds;
-  std::map<std::string, std::string> nameToPositionMap;
-  
-  IdToNameMap idToName;
-  NameToIdMap nameToOutgoingId;
-  NameToIdMap nameToIncomingId;
-  std::map<std::string, std::string> nameToString;
-  
-  NodeToIdMap nodeToId_;
-  IdToNodeMap idToNode_;
 
-  void addNewNode(const std::string& name, bool decl);
-  void addNameToGraph(const std::string& name, bool canDecl);
-  Node addSuperSink(const std::set<std::string>& names);
-  
-  void computeDominators(std::map< Node,std::set<Node> >& dominators, const Node& r);
-  void computeImmediateDominatorsFast(std::map< Node,std::set<Node> >& dominators, const Node& r);
-  void compactGraphFromImmediateDominators(std::map< Node, Node>& idoms);
-  void pruneGraphFromDominators(const std::map< Node, std::set< Node > >& dominators);
-  bool isKeepNode(const Node& node);
-  
-  const std::string& nodeToString(Node n);
-  int nodeToId(Node n);
+  // every name is interned once; the per-name tables below are indexed by
+  // its symbol and the per-id table by the (dense) node id
+  SymbolTable symbols_;
+  std::vector<Symbol> idToSymbol_;
+  std::vector<int> symbolToIncomingId_;   // -1 if the name has no node yet
+  std::vector<int> symbolToOutgoingId_;
+  // metadata read during ingestion stays in the file until a cut needs
+  // it; the maps only hold strings added directly or loaded from a cache
+  MetadataStore metadata_;
+  std::map<Symbol, std::string> symbolToPosition_;
+  std::map<Symbol, std::string> symbolToAsString_;
+
+  // built by freeze(): frozen node i is the node with id i, and the arcs
+  // are grouped by source so every out-arc list is contiguous
+  FrozenGraph frozen_;
+  FrozenCapMap frozenCapacities_;
+  std::map<Symbol, FrozenGraph::Arc> frozenSuperSinkArcs_;
+
+  static const std::string emptyString;
+
+  void addNewNode(Symbol name, bool decl);
+  void addNameToGraph(Symbol name, bool canDecl);
+  bool hasNode(Symbol name) const;
+  void buildFrozen();
 
   static const int INFINITY_HACK = 1000;
+
+  friend class LabelGraph;
+  friend class GraphCache;
   
 public:
 	
-  SimpGraph(TimeManager& tm) : nextId(0), fgCapacities(fg), tm_(tm) { }
-
-  const std::string& getNameForId(int id);
-  int getOutgoingIdForName(const std::string& name, bool decl = false);
-  int getIncomingIdForName(const std::string& name, bool decl = false);
-  void addNameConnection(const std::string& name1, bool decl1, const std::string& name2, bool decl2);
-  void addNamePositionConnection(const std::string& name, const std::string& pos);
-  void addAsString(const std::string& name, const std::string& asString);
-  const FlowGraph& getFlowGraph();
+  SimpGraph(TimeManager& tm) : list_(new Construction()), nextId(0), tm_(tm), frozenCapacities_(frozen_) { }
+
+  Symbol intern(const char* name) { return symbols_.intern(name); }
+  Symbol intern(const std::string& name) { return symbols_.intern(name); }
+  Symbol findSymbol(const std::string& name) const { return symbols_.find(name); }
+  const SymbolTable& getSymbols() const { return symbols_; }
+
+  std::string getNameForId(int id) const;
+  int getOutgoingIdForName(Symbol name, bool decl = false);
+  int getIncomingIdForName(Symbol name, bool decl = false);
+  void addNameConnection(Symbol name1, bool decl1, Symbol name2, bool decl2);
+  void addNamePositionConnection(Symbol name, const std::string& pos);
+  void addAsString(Symbol name, const std::string& asString);
+  void setMetadataSource(const std::string& fileName) { metadata_.setSource(fileName); }
+  void addMetadataExtent(Symbol name, const ElementExtent& extent) { metadata_.add(name, extent); }
+  // every name's position and asString, fetching the lazy ones
+  void collectMetadata(std::map<Symbol, std::string>& positions, std::map<Symbol, std::string>& asStrings) const;
+  // the list graph exists only until freeze(): names can be added and the
+  // list graph read or copied before it, not after.  copySimpGraph returns
+  // false, leaving simpGraph alone, once it is gone.
+  bool isFrozen() const { return !list_; }
+  const FlowGraph& getFlowGraph() const;
   void outputToFile(const std::string& fileName);
-  void pruneFlowGraph(const std::string& name1, const std::set<std::string>& names);
-  void copySimpGraph(SimpGraph& simpGraph);
-  void performMinimumCut(const std::string& startName);
+  bool copySimpGraph(SimpGraph& simpGraph);
   void getStats(GraphStats& graphStats);
-  std::map<Node,std::string> getNodeStringMap() {
-	  // fix the copy-on-return thing
-	  std::map<Node,std::string> returnMap;
-	  for(NodeIt v(this->fg); v != INVALID; ++v) {
-		  returnMap[v] = nodeToString(v);
-	  }
-	  return returnMap;
-  }
+
+  // adds #SUPERSINK and an arc into it from every name; call once, after
+  // parsing and before any LabelGraph is made over this graph
+  void prepareSuperSink(const std::set<std::string>& names);
+  Node getSuperSink() const;
+
+  // compiles the list graph into the frozen CSR image and drops it, so the
+  // base graph is held once; call after prepareSuperSink and before any LabelGraph is
+  // made over this graph
+  void freeze();
+  const FrozenGraph& getFrozenGraph() const { return frozen_; }
+  const FrozenCapMap& getFrozenCapacities() const { return frozenCapacities_; }
+
+  // list graph nodes; INVALID or -1 after freeze()
+  Node getOutgoingNodeForName(const std::string& name) const;
+  Node getOutgoingNodeForSymbol(Symbol name) const;
+  int findOutgoingId(const std::string& name) const;
+  Symbol getSymbolForId(int id) const;
+  Node getNodeForId(int id) const;
+  std::string nodeToString(Node n) const;
+  Symbol nodeToSymbol(Node n) const;
+  int nodeToId(Node n) const;
+  // both strings from one read of the name's <con>
+  void getMetadataForSymbol(Symbol name, std::string& position, std::string& asString) const;
+  std::string getPositionForSymbol(Symbol name) const;
+  std::string getAsStringForSymbol(Symbol name) const;
 };
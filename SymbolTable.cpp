@@ -0,0 +1,67 @@
+#include "SymbolTable.h"
+
+const Symbol SymbolTable::NO_SYMBOL;
+
+SymbolTable::SymbolTable() : offsets_(1, 0), index_(1024, NO_SYMBOL) {
+}
+
+unsigned int
+SymbolTable::hash(const char* name, size_t length) {
+	// FNV-1a
+	unsigned int h = 2166136261u;
+	for(size_t i = 0; i < length; ++i) {
+		h ^= (unsigned char) name[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+size_t
+SymbolTable::slot(const char* name, size_t length, unsigned int h) const {
+	size_t mask = index_.size() - 1;
+	for(size_t i = h & mask; ; i = (i + 1) & mask) {
+		Symbol s = index_[i];
+		if (s == NO_SYMBOL)
+			return i;
+		if (hashes_[s] == h && this->length(s) == length && memcmp(this->name(s), name, length) == 0)
+			return i;
+	}
+}
+
+void
+SymbolTable::rehash(size_t slots) {
+	std::vector<Symbol> index(slots, NO_SYMBOL);
+	size_t mask = index.size() - 1;
+	for(Symbol s = 0; s < hashes_.size(); ++s) {
+		size_t i = hashes_[s] & mask;
+		while (index[i] != NO_SYMBOL)
+			i = (i + 1) & mask;
+		index[i] = s;
+	}
+	index_.swap(index);
+}
+
+Symbol
+SymbolTable::intern(const char* name, size_t length) {
+	unsigned int h = hash(name, length);
+	size_t i = slot(name, length, h);
+	if (index_[i] != NO_SYMBOL)
+		return index_[i];
+
+	Symbol s = hashes_.size();
+	arena_.insert(arena_.end(), name, name + length);
+	arena_.push_back('\0');
+	offsets_.push_back(arena_.size());
+	hashes_.push_back(h);
+	index_[i] = s;
+
+	// keep the load factor at or below one half
+	if (2 * hashes_.size() > index_.size())
+		rehash(index_.size() * 2);
+	return s;
+}
+
+Symbol
+SymbolTable::find(const char* name, size_t length) const {
+	return index_[slot(name, length, hash(name, length))];
+}
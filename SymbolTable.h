@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <string.h>
+
+typedef unsigned int Symbol;
+
+// interns constraint names: every distinct name is stored once, NUL
+// terminated, in a single character arena and is identified by a dense
+// 32-bit symbol.  lookups go through an open-addressing hash index over
+// the symbols, so a name costs one hash and usually one memcmp.
+class SymbolTable {
+
+public:
+	static const Symbol NO_SYMBOL = 0xffffffffu;
+
+protected:
+	std::vector<char> arena_;
+	std::vector<size_t> offsets_;      // symbol -> start in arena_, plus an end sentinel
+	std::vector<unsigned int> hashes_; // symbol -> hash of its name
+	std::vector<Symbol> index_;        // open addressing, NO_SYMBOL marks a free slot
+
+	static unsigned int hash(const char* name, size_t length);
+	size_t slot(const char* name, size_t length, unsigned int h) const;
+	void rehash(size_t slots);
+
+	friend class GraphCache;
+
+public:
+	SymbolTable();
+
+	Symbol intern(const char* name, size_t length);
+	Symbol intern(const char* name) { return intern(name, strlen(name)); }
+	Symbol intern(const std::string& name) { return intern(name.data(), name.size()); }
+
+	Symbol find(const char* name, size_t length) const;
+	Symbol find(const std::string& name) const { return find(name.data(), name.size()); }
+
+	const char* name(Symbol symbol) const { return &arena_[offsets_[symbol]]; }
+	size_t length(Symbol symbol) const { return offsets_[symbol + 1] - offsets_[symbol] - 1; }
+	std::string str(Symbol symbol) const { return std::string(name(symbol), length(symbol)); }
+
+	size_t size() const { return hashes_.size(); }
+	size_t arenaBytes() const { return arena_.size(); }
+};
@@ -0,0 +1,96 @@
+#include "SyntheticGraph.h"
+
+#include <sstream>
+#include <algorithm>
+
+SyntheticGraph::SyntheticGraph(const SyntheticOptions& options) : options_(options), numLabels_(0) {
+	options_.numNodes = std::max(2, options_.numNodes);
+	options_.depth = std::min(std::max(2, options_.depth), options_.numNodes);
+	options_.taint = std::max(1, options_.taint);
+	buildLattice();
+
+	Random random(options_.seed);
+	canDecl_.resize(options_.numNodes);
+	nv_.resize(options_.numNodes);
+	for(int v = 0; v < options_.numNodes; ++v) {
+		canDecl_[v] = random.real() < options_.decl;
+		nv_[v] = random.real() < options_.nv;
+	}
+
+	for(int i = 0; i < numLabels_; ++i) {
+		for(int t = 0; t < options_.taint; ++t) {
+			int v = pickInLayer(random, 0);
+			constraints_.push_back(std::make_pair(labelIndex(i), v));
+			int w = pickInLayer(random, options_.depth - 1);
+			constraints_.push_back(std::make_pair(w, labelIndex(i)));
+		}
+	}
+
+	long long numConstraints = options_.numConstraints >= 0 ? options_.numConstraints : 3LL * options_.numNodes;
+	constraints_.reserve(constraints_.size() + numConstraints);
+	for(long long c = 0; c < numConstraints; ++c) {
+		// forward one layer, or back to any earlier layer to close a cycle
+		int l = random.below(options_.depth - 1);
+		int v = pickInLayer(random, l);
+		int targetLayer = random.real() < options_.cycles ? random.below(l + 1) : l + 1;
+		int w = pickInLayer(random, targetLayer);
+		constraints_.push_back(std::make_pair(v, w));
+	}
+}
+
+void
+SyntheticGraph::buildLattice() {
+	int k = std::max(1, options_.labels);
+	if (options_.lattice == "chain") {
+		for(int i = 0; i + 1 < k; ++i)
+			leqs_.push_back(std::make_pair(i, i + 1));
+		numLabels_ = k;
+	}
+	else if (options_.lattice == "powerset") {
+		// one label per subset, ordered by inclusion; only the covering pairs
+		numLabels_ = 1 << k;
+		for(int s = 0; s < numLabels_; ++s) {
+			for(int bit = 0; (1 << bit) < numLabels_; ++bit) {
+				if (!(s & (1 << bit)))
+					leqs_.push_back(std::make_pair(s, s | (1 << bit)));
+			}
+		}
+	}
+	else {
+		// diamond: a bottom, k incomparable labels and a top
+		for(int i = 1; i <= k; ++i) {
+			leqs_.push_back(std::make_pair(0, i));
+			leqs_.push_back(std::make_pair(i, k + 1));
+		}
+		numLabels_ = k + 2;
+	}
+}
+
+// skew concentrates the picks on the low indices of the layer: the pick is
+// the least of 1 + skew draws, the fraction being the chance of one more.
+// only comparisons and integer draws, so no libm result can change a file.
+int
+SyntheticGraph::pickInLayer(Random& random, int l) const {
+	int layerSize = options_.numNodes / options_.depth;
+	int first = l * layerSize;
+	int size = l == options_.depth - 1 ? options_.numNodes - first : layerSize;
+	int pick = random.below(size);
+	if (options_.skew > 0) {
+		int extra = (int) options_.skew;
+		if (random.real() < options_.skew - extra)
+			++extra;
+		for(int d = 0; d < extra; ++d)
+			pick = std::min(pick, random.below(size));
+	}
+	return first + pick;
+}
+
+std::string
+SyntheticGraph::name(int n) const {
+	std::ostringstream os;
+	if (n >= options_.numNodes)
+		os << "LATTICE#" << n - options_.numNodes;
+	else
+		os << (nv_[n] ? "NV" : "v") << n;
+	return os.str();
+}
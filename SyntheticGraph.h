@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+
+// xorshift64*; the standard distributions differ between libraries, so all
+// draws go through this
+class Random {
+	unsigned long long state_;
+
+public:
+	Random(unsigned long long seed) : state_(seed * 2654435761ULL + 0x9e3779b97f4a7c15ULL) {
+		if (state_ == 0)
+			state_ = 1;
+	}
+
+	unsigned long long next() {
+		state_ ^= state_ >> 12;
+		state_ ^= state_ << 25;
+		state_ ^= state_ >> 27;
+		return state_ * 2685821657736338717ULL;
+	}
+
+	// uniform in [0, 1)
+	double real() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+	// uniform in [0, n)
+	int below(int n) { return (int) (real() * n); }
+};
+
+struct SyntheticOptions {
+	unsigned long long seed;
+	int numNodes;
+	long long numConstraints;   // -1 for three per name
+	int depth;              // layers a constraint chain walks through
+	double cycles;          // share of constraints pointing back a layer or more
+	double decl;            // share of names with canDecl
+	double nv;              // share of names containing NV
+	double skew;            // 0 spreads targets evenly, larger makes hubs
+	std::string lattice;    // chain, diamond or powerset
+	int labels;             // chain length, diamond width or powerset atoms (at most 12)
+	int taint;              // source and sink names per label
+
+	SyntheticOptions() : seed(1), numNodes(1000), numConstraints(-1), depth(10), cycles(0.05),
+		decl(0.3), nv(0.05), skew(0), lattice("diamond"), labels(2), taint(3) { }
+
+	bool valid() const {
+		if (lattice == "powerset")
+			return labels <= 12;
+		return lattice == "chain" || lattice == "diamond";
+	}
+};
+
+// a reproducible constraint set: the names are split into depth layers and
+// constraints mostly lead from one layer to the next, so chains are about
+// depth long.  every label taints a few names of the first layer and a few
+// names of the last layer flow into every label.  names are indices: the
+// numNodes variables first, then the labels.
+class SyntheticGraph {
+
+protected:
+	SyntheticOptions options_;
+	int numLabels_;
+	std::vector< std::pair<int, int> > leqs_;
+	std::vector<char> canDecl_;
+	std::vector<char> nv_;
+	std::vector< std::pair<int, int> > constraints_;
+
+	void buildLattice();
+	int pickInLayer(Random& random, int l) const;
+
+public:
+	SyntheticGraph(const SyntheticOptions& options);
+
+	int numNodes() const { return options_.numNodes; }
+	int numLabels() const { return numLabels_; }
+	int numNames() const { return options_.numNodes + numLabels_; }
+	int labelIndex(int id) const { return options_.numNodes + id; }
+
+	// the <lt lhs rhs> pairs over label ids
+	const std::vector< std::pair<int, int> >& getLeqs() const { return leqs_; }
+	// lhs <= rhs, in the order they are written out
+	const std::vector< std::pair<int, int> >& getConstraints() const { return constraints_; }
+
+	std::string name(int n) const;
+	// written with canDecl="true"
+	bool hasCanDecl(int n) const { return n < options_.numNodes && canDecl_[n]; }
+	// split into an in and an out node, as SimpGraph does for canDecl or NV
+	bool isDecl(int n) const { return n < options_.numNodes && (canDecl_[n] || nv_[n]); }
+};
@@ -1,55 +1,461 @@
 #include "TimeManager.h"
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
 
-TimeManager::TimeManager()
+static std::atomic<unsigned long> nextManagerId(1);
+static std::atomic<int> nextThread(0);
+
+int
+TimeManager::ThreadBuffer::intern(const std::string& str) {
+	std::map<std::string, int>::iterator itString = stringIds.find(str);
+	if (itString != stringIds.end())
+		return itString->second;
+	int id = strings.size();
+	strings.push_back(str);
+	stringIds[str] = id;
+	return id;
+}
+
+TimeManager::TimeManager() : id_(nextManagerId++), epoch_(Clock::now()), hardwareCounters_(false), memoryTracking_(MEMORY_OFF)
 {
 }
 
 TimeManager::~TimeManager()
 {
+	for(std::vector<ThreadBuffer*>::iterator itBuffers = buffers_.begin();
+		itBuffers != buffers_.end();
+		++itBuffers) {
+		delete *itBuffers;
+	}
+}
+
+TimeManager::ThreadBuffer*
+TimeManager::addBuffer(std::thread::id owner, int thread) {
+	ThreadBuffer* b = new ThreadBuffer();
+	b->owner = owner;
+	b->thread = thread;
+	b->currentName = b->intern("");
+	buffers_.push_back(b);
+	return b;
+}
+
+const PerfCounters*
+TimeManager::counters(ThreadBuffer& b) {
+	if (!hardwareCounters_)
+		return 0;
+	// counters measure the thread that opens them, so each buffer opens its own
+	if (b.counters == 0)
+		b.counters = new PerfCounters();
+	return b.counters->available() ? b.counters : 0;
+}
+
+TimeManager::ThreadBuffer&
+TimeManager::buffer() {
+	// a thread almost always talks to one manager, so remember the last one;
+	// manager ids are never reused, so a stale cache entry cannot match
+	thread_local unsigned long cachedManager = 0;
+	thread_local ThreadBuffer* cachedBuffer = 0;
+	thread_local int threadIndex = nextThread++;
+	if (cachedManager == id_)
+		return *cachedBuffer;
+
+	std::lock_guard<std::mutex> lock(buffersMutex_);
+	std::thread::id self = std::this_thread::get_id();
+	ThreadBuffer* found = 0;
+	for(std::vector<ThreadBuffer*>::iterator itBuffers = buffers_.begin();
+		itBuffers != buffers_.end() && found == 0;
+		++itBuffers) {
+		if ((*itBuffers)->owner == self)
+			found = *itBuffers;
+	}
+	if (found == 0)
+		found = addBuffer(self, threadIndex);
+	cachedManager = id_;
+	cachedBuffer = found;
+	return *found;
 }
 
 void 
 TimeManager::start(const std::string& str) {
-	gettimeofday(&(timevalMap_[currentName_][str].first), NULL);
+	ThreadBuffer& b = buffer();
+	OpenScope scope;
+	scope.name = b.currentName;
+	scope.category = b.intern(str);
+	scope.memoryTracking = memoryTracking_;
+	if (scope.memoryTracking != MEMORY_OFF)
+		scope.memory = MemoryUsage::current(scope.memoryTracking == MEMORY_HEAP);
+	const PerfCounters* perf = counters(b);
+	if (perf != 0)
+		scope.counters = perf->read();
+	scope.start = Clock::now();
+	b.open.push_back(scope);
 }
 
 void 
 TimeManager::stop(const std::string& str) {
-	gettimeofday(&(timevalMap_[currentName_][str].second), NULL);
+	Clock::time_point now = Clock::now();
+	ThreadBuffer& b = buffer();
+	const PerfCounters* perf = counters(b);
+	PerfCounters::Values values;
+	if (perf != 0)
+		values = perf->read();
+	int category = b.intern(str);
+	// scopes normally close innermost first, so search from the top
+	for(size_t i = b.open.size(); i > 0; --i) {
+		if (b.open[i - 1].category != category)
+			continue;
+		Sample sample;
+		sample.name = b.open[i - 1].name;
+		sample.category = category;
+		sample.start = std::chrono::duration_cast<std::chrono::nanoseconds>(b.open[i - 1].start - epoch_).count();
+		sample.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(now - b.open[i - 1].start).count();
+		sample.memoryTracking = b.open[i - 1].memoryTracking;
+		MemoryUsage memory;
+		if (sample.memoryTracking != MEMORY_OFF)
+			memory = MemoryUsage::current(sample.memoryTracking == MEMORY_HEAP);
+		sample.rss = memory.rss;
+		sample.peakRss = memory.peakRss;
+		sample.rssDelta = memory.rss - b.open[i - 1].memory.rss;
+		sample.heapDelta = memory.heap - b.open[i - 1].memory.heap;
+		// a counter counts only if both ends of the scope measured it
+		sample.counted = perf != 0;
+		sample.counterMask = values.mask & b.open[i - 1].counters.mask;
+		for(int c = 0; c < PerfCounters::NUM_COUNTERS; ++c) {
+			if (sample.counterMask & (1 << c))
+				sample.counters.value[c] = values.value[c] - b.open[i - 1].counters.value[c];
+		}
+		b.samples.push_back(sample);
+		b.open.erase(b.open.begin() + (i - 1));
+		return;
+	}
 }
 
 void 
 TimeManager::setName(const std::string& name) {
-	currentName_ = name;
+	ThreadBuffer& b = buffer();
+	b.currentName = b.intern(name);
 }
 
 void 
 TimeManager::unsetName() {
-	currentName_ = "";
+	ThreadBuffer& b = buffer();
+	b.currentName = b.intern("");
 }
 	
+// summed hardware counters over a set of samples; a counter that any of
+// them missed has no meaningful total and prints as n/a
+struct CounterTotals {
+	int mask;
+	int missing;
+	PerfCounters::Values totals;
+
+	CounterTotals() : mask(0), missing(0) { }
+
+	void add(const TimeManager::Sample& sample) {
+		mask |= sample.counterMask;
+		missing |= ~sample.counterMask;
+		for(int c = 0; c < PerfCounters::NUM_COUNTERS; ++c)
+			totals.value[c] += sample.counters.value[c];
+	}
+
+	void output(const std::string& key) const {
+		int measured = mask & ~missing;
+		std::cout << std::left << std::setw(40) << key << std::right;
+		for(int c = 0; c < PerfCounters::NUM_COUNTERS; ++c) {
+			if (measured & (1 << c))
+				std::cout << std::setw(15) << totals.value[c];
+			else
+				std::cout << std::setw(15) << "n/a";
+		}
+		long long cycles = totals.value[PerfCounters::CYCLES];
+		if ((measured & (1 << PerfCounters::CYCLES)) && (measured & (1 << PerfCounters::INSTRUCTIONS)) && cycles > 0)
+			std::cout << std::setw(7) << (double) totals.value[PerfCounters::INSTRUCTIONS] / cycles;
+		std::cout << std::endl;
+	}
+};
+
+void
+TimeManager::summarize(std::map<std::string, PhaseSummary>& phases) {
+	std::map<std::string, std::vector< std::pair<long long, std::string> > > samplesByPhase;
+	{
+		std::lock_guard<std::mutex> lock(buffersMutex_);
+		for(std::vector<ThreadBuffer*>::iterator itBuffers = buffers_.begin();
+			itBuffers != buffers_.end();
+			++itBuffers) {
+			const ThreadBuffer& b = **itBuffers;
+			for(std::vector<Sample>::const_iterator itSamples = b.samples.begin();
+				itSamples != b.samples.end();
+				++itSamples) {
+				samplesByPhase[b.strings[itSamples->category]].push_back(std::make_pair(itSamples->duration, b.strings[itSamples->name]));
+			}
+		}
+	}
+
+	phases.clear();
+	for(std::map<std::string, std::vector< std::pair<long long, std::string> > >::iterator itPhases(samplesByPhase.begin());
+		itPhases != samplesByPhase.end();
+		++itPhases) {
+		std::vector< std::pair<long long, std::string> >& samples = itPhases->second;
+		std::sort(samples.begin(), samples.end());
+		PhaseSummary& summary = phases[itPhases->first];
+		size_t n = samples.size();
+		summary.count = n;
+		summary.total = 0;
+		for(size_t i = 0; i < n; ++i)
+			summary.total += samples[i].first;
+		summary.min = samples.front().first;
+		summary.max = samples.back().first;
+		// nearest-rank percentiles
+		summary.p50 = samples[(n + 1) / 2 - 1].first;
+		summary.p99 = samples[(99 * n + 99) / 100 - 1].first;
+		summary.slowest = samples.back().second;
+	}
+}
+
 void 
 TimeManager::outputTimes() {
-	std::cout << std::setfill('-') << std::setw(60) << "" << std::endl;
-	std::cout << std::setfill(' ') << std::right << std::setw(30) << "TIMES" << std::endl;
-	std::cout << std::setfill('-') << std::setw(60) << "" << std::endl;
+	std::map<std::string, PhaseSummary> phases;
+	summarize(phases);
+
+	std::map<std::string, CounterTotals> phaseCounters;
+	std::map<std::string, CounterTotals> labelCounters;
+	{
+		std::lock_guard<std::mutex> lock(buffersMutex_);
+		for(std::vector<ThreadBuffer*>::iterator itBuffers = buffers_.begin();
+			itBuffers != buffers_.end();
+			++itBuffers) {
+			const ThreadBuffer& b = **itBuffers;
+			for(std::vector<Sample>::const_iterator itSamples = b.samples.begin();
+				itSamples != b.samples.end();
+				++itSamples) {
+				if (!itSamples->counted)
+					continue;
+				phaseCounters[b.strings[itSamples->category]].add(*itSamples);
+				if (!b.strings[itSamples->name].empty())
+					labelCounters[b.strings[itSamples->name] + " / " + b.strings[itSamples->category]].add(*itSamples);
+			}
+		}
+	}
+
+	std::cout << std::setfill('-') << std::setw(110) << "" << std::endl;
+	std::cout << std::setfill(' ') << std::right << std::setw(55) << "TIMES" << std::endl;
+	std::cout << std::setfill('-') << std::setw(110) << "" << std::endl;
+	std::cout << std::setfill(' ') << std::left << std::setw(25) << "phase" << std::right
+		<< std::setw(8) << "count" << std::setw(12) << "total" << std::setw(12) << "min"
+		<< std::setw(12) << "max" << std::setw(12) << "p50" << std::setw(12) << "p99"
+		<< "  slowest" << std::endl;
+	std::cout << std::fixed << std::setprecision(6);
+	for(std::map<std::string, PhaseSummary>::iterator itPhases(phases.begin());
+		itPhases != phases.end();
+		++itPhases) {
+		const PhaseSummary& summary = itPhases->second;
+		std::cout << std::left << std::setw(25) << itPhases->first << std::right
+			<< std::setw(8) << summary.count
+			<< std::setw(11) << summary.total / 1e9 << "s"
+			<< std::setw(11) << summary.min / 1e9 << "s"
+			<< std::setw(11) << summary.max / 1e9 << "s"
+			<< std::setw(11) << summary.p50 / 1e9 << "s"
+			<< std::setw(11) << summary.p99 / 1e9 << "s"
+			<< "  " << summary.slowest << std::endl;
+	}
+	std::cout << std::setfill('-') << std::setw(110) << "" << std::endl;
 	std::cout << std::setfill(' ');
-	for(std::map<std::string, std::map<std::string, std::pair<timeval, timeval> > >::iterator itTimeMap(timevalMap_.begin());
-		itTimeMap != timevalMap_.end();
-		++itTimeMap) {
-		std::string currentCategory = itTimeMap->first;
-		if (currentCategory.length() > 0)
-			std::cout << currentCategory << ":" << std::endl;
-		for(std::map< std::string, std::pair<timeval, timeval> >::iterator itCategory(itTimeMap->second.begin()); 
-			itCategory != itTimeMap->second.end(); 
-			++itCategory) {
-			double diff = itCategory->second.second.tv_sec - itCategory->second.first.tv_sec;
-			diff += (itCategory->second.second.tv_usec - itCategory->second.first.tv_usec) / (1000.0 * 1000.0);
-			std::cout << "\t" << std::left << std::setw(25) << itCategory->first << ": " << diff << "s" << std::endl;
-		}
-	}
-	std::cout << std::setfill('-') << std::setw(60) << "" << std::endl;
+
+	if (phaseCounters.empty())
+		return;
+	std::cout << std::setfill(' ') << std::right << std::setw(55) << "COUNTERS" << std::endl;
+	std::cout << std::setfill('-') << std::setw(110) << "" << std::endl;
+	std::cout << std::setfill(' ') << std::left << std::setw(40) << "phase" << std::right;
+	for(int c = 0; c < PerfCounters::NUM_COUNTERS; ++c)
+		std::cout << std::setw(15) << PerfCounters::name((PerfCounters::Counter) c);
+	std::cout << std::setw(7) << "IPC" << std::endl;
+	std::cout << std::setprecision(2);
+	for(std::map<std::string, CounterTotals>::iterator itCounters(phaseCounters.begin());
+		itCounters != phaseCounters.end();
+		++itCounters) {
+		itCounters->second.output(itCounters->first);
+	}
+	if (!labelCounters.empty()) {
+		std::cout << std::setfill('-') << std::setw(110) << "" << std::endl;
+		std::cout << std::setfill(' ');
+		for(std::map<std::string, CounterTotals>::iterator itCounters(labelCounters.begin());
+			itCounters != labelCounters.end();
+			++itCounters) {
+			itCounters->second.output(itCounters->first);
+		}
+	}
+	std::cout << std::setfill('-') << std::setw(110) << "" << std::endl;
 	std::cout << std::setfill(' ');
 }
+
+// largest values seen over a set of samples
+struct MemoryPeak {
+	int count;
+	bool heap;
+	long long rss;
+	long long peakRss;
+	long long rssDelta;
+	long long heapDelta;
+	std::string heapPhase;
+
+	MemoryPeak() : count(0), heap(false), rss(0), peakRss(0), rssDelta(0), heapDelta(0) { }
+
+	void add(const TimeManager::Sample& sample, const std::string& phase) {
+		++count;
+		heap = heap || sample.memoryTracking == TimeManager::MEMORY_HEAP;
+		rss = std::max(rss, sample.rss);
+		peakRss = std::max(peakRss, sample.peakRss);
+		rssDelta = std::max(rssDelta, sample.rssDelta);
+		if (heapPhase.empty() || sample.heapDelta > heapDelta) {
+			heapDelta = sample.heapDelta;
+			heapPhase = phase;
+		}
+	}
+};
+
+static void
+outputMemoryRow(const std::string& key, const MemoryPeak& peak, bool showPhase) {
+	std::cout << std::left << std::setw(25) << key << std::right
+		<< std::setw(8) << peak.count
+		<< std::setw(11) << peak.rss / 1048576.0 << "M"
+		<< std::setw(11) << peak.peakRss / 1048576.0 << "M"
+		<< std::setw(11) << peak.rssDelta / 1048576.0 << "M";
+	if (!peak.heap) {
+		std::cout << std::setw(12) << "n/a" << std::endl;
+		return;
+	}
+	std::cout << std::setw(11) << peak.heapDelta / 1048576.0 << "M";
+	if (showPhase)
+		std::cout << "  " << peak.heapPhase;
+	std::cout << std::endl;
+}
+
+void
+TimeManager::outputMemory() {
+	std::map<std::string, MemoryPeak> phases;
+	std::map<std::string, MemoryPeak> labels;
+	{
+		std::lock_guard<std::mutex> lock(buffersMutex_);
+		for(std::vector<ThreadBuffer*>::iterator itBuffers = buffers_.begin();
+			itBuffers != buffers_.end();
+			++itBuffers) {
+			const ThreadBuffer& b = **itBuffers;
+			for(std::vector<Sample>::const_iterator itSamples = b.samples.begin();
+				itSamples != b.samples.end();
+				++itSamples) {
+				if (itSamples->memoryTracking == MEMORY_OFF)
+					continue;
+				const std::string& phase = b.strings[itSamples->category];
+				phases[phase].add(*itSamples, phase);
+				if (!b.strings[itSamples->name].empty())
+					labels[b.strings[itSamples->name]].add(*itSamples, phase);
+			}
+		}
+	}
+	if (phases.empty())
+		return;
+
+	std::cout << std::setfill('-') << std::setw(110) << "" << std::endl;
+	std::cout << std::setfill(' ') << std::right << std::setw(55) << "MEMORY" << std::endl;
+	std::cout << std::setfill('-') << std::setw(110) << "" << std::endl;
+	std::cout << std::setfill(' ') << std::left << std::setw(25) << "phase" << std::right
+		<< std::setw(8) << "count" << std::setw(12) << "rss" << std::setw(12) << "peak rss"
+		<< std::setw(12) << "max +rss" << std::setw(12) << "max +heap" << std::endl;
+	std::cout << std::fixed << std::setprecision(1);
+	for(std::map<std::string, MemoryPeak>::iterator itPhases(phases.begin());
+		itPhases != phases.end();
+		++itPhases) {
+		outputMemoryRow(itPhases->first, itPhases->second, false);
+	}
+	if (!labels.empty()) {
+		std::cout << std::setfill('-') << std::setw(110) << "" << std::endl;
+		std::cout << std::setfill(' ') << std::left << std::setw(25) << "label" << std::right
+			<< std::setw(8) << "phases" << std::setw(12) << "rss" << std::setw(12) << "peak rss"
+			<< std::setw(12) << "max +rss" << std::setw(12) << "max +heap" << "  in phase" << std::endl;
+		for(std::map<std::string, MemoryPeak>::iterator itLabels(labels.begin());
+			itLabels != labels.end();
+			++itLabels) {
+			outputMemoryRow(itLabels->first, itLabels->second, true);
+		}
+	}
+	std::cout << std::setfill('-') << std::setw(110) << "" << std::endl;
+	std::cout << std::setfill(' ');
+}
+
+static void
+writeJsonString(std::ostream& os, const std::string& str) {
+	os << '"';
+	for(std::string::const_iterator c = str.begin(); c != str.end(); ++c) {
+		if (*c == '"' || *c == '\\')
+			os << '\\' << *c;
+		else if ((unsigned char) *c < 0x20)
+			os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int) *c << std::dec << std::setfill(' ');
+		else
+			os << *c;
+	}
+	os << '"';
+}
+
+bool
+TimeManager::writeTrace(const std::string& fileName) {
+	std::ofstream os(fileName.c_str());
+	if (!os) {
+		std::cout << "could not write trace " << fileName << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(buffersMutex_);
+	std::map<int, bool> threads;
+	os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	os << std::fixed << std::setprecision(3);
+	for(std::vector<ThreadBuffer*>::iterator itBuffers = buffers_.begin();
+		itBuffers != buffers_.end();
+		++itBuffers) {
+		const ThreadBuffer& b = **itBuffers;
+		threads[b.thread] = true;
+		for(std::vector<Sample>::const_iterator itSamples = b.samples.begin();
+			itSamples != b.samples.end();
+			++itSamples) {
+			// complete events in microseconds; the label is the event category
+			// so Perfetto can filter on it
+			const std::string& name = b.strings[itSamples->name];
+			os << (first ? "\n" : ",\n") << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << b.thread;
+			os << ",\"ts\":" << itSamples->start / 1e3 << ",\"dur\":" << itSamples->duration / 1e3;
+			os << ",\"name\":";
+			writeJsonString(os, b.strings[itSamples->category]);
+			os << ",\"cat\":";
+			writeJsonString(os, name.empty() ? "global" : name);
+			os << ",\"args\":{";
+			const char* separator = "";
+			if (!name.empty()) {
+				os << "\"label\":";
+				writeJsonString(os, name);
+				separator = ",";
+			}
+			if (itSamples->memoryTracking != MEMORY_OFF)
+				os << separator << "\"rss MB\":" << itSamples->rss / 1048576.0;
+			if (itSamples->memoryTracking == MEMORY_HEAP)
+				os << ",\"heap delta MB\":" << itSamples->heapDelta / 1048576.0;
+			os << "}}";
+			// resident memory as a counter track next to the phases
+			if (itSamples->memoryTracking != MEMORY_OFF) {
+				os << ",\n{\"ph\":\"C\",\"pid\":1,\"name\":\"rss\",\"ts\":" << (itSamples->start + itSamples->duration) / 1e3;
+				os << ",\"args\":{\"MB\":" << itSamples->rss / 1048576.0 << "}}";
+			}
+			first = false;
+		}
+	}
+	for(std::map<int, bool>::iterator itThreads = threads.begin();
+		itThreads != threads.end();
+		++itThreads) {
+		os << (first ? "\n" : ",\n") << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << itThreads->first;
+		os << ",\"name\":\"thread_name\",\"args\":{\"name\":\"thread " << itThreads->first << "\"}}";
+		first = false;
+	}
+	os << "\n]}\n";
+	return os.good();
+}
@@ -3,27 +3,137 @@
 
 #include <string>
 #include <map>
-#include <time.h>
-#include <sys/time.h>
+#include <vector>
 #include <utility>
+#include <mutex>
+#include <thread>
+#include <chrono>
 
+#include "MemoryUsage.h"
+#include "PerfCounters.h"
+
+// collects timed phases, optionally grouped under a name (e.g. the label
+// being analysed).  every start/stop pair is kept as a sample, so repeated
+// phases aggregate instead of overwriting each other.  each thread records
+// into its own buffer without taking a lock; the lock is only taken the
+// first time a thread uses a manager and when the samples are read out.
 class TimeManager
 {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	// what start and stop read besides the clock; off by default
+	enum MemoryTracking { MEMORY_OFF, MEMORY_RSS, MEMORY_HEAP };
+
+	// one finished interval, in nanoseconds since the manager was created,
+	// with the memory it left behind in bytes
+	struct Sample {
+		int name;
+		int category;
+		long long start;
+		long long duration;
+		long long rss;         // at stop
+		long long peakRss;     // process high-water mark at stop
+		long long rssDelta;
+		long long heapDelta;
+		int memoryTracking;    // what was read; the fields above are 0 if off
+		bool counted;          // hardware counters were open for this scope
+		int counterMask;       // bit c is set if counter c was read
+		PerfCounters::Values counters;
+	};
+
+	// one phase's samples across all threads and names, in nanoseconds
+	struct PhaseSummary {
+		int count;
+		long long total;
+		long long min;
+		long long max;
+		long long p50;
+		long long p99;
+		std::string slowest;    // name of the longest sample
+	};
+
 protected:
-	std::map<std::string, std::map<std::string, std::pair<timeval, timeval> > > timevalMap_;
-	std::string currentName_;
+	struct OpenScope {
+		int name;
+		int category;
+		Clock::time_point start;
+		int memoryTracking;
+		MemoryUsage memory;
+		PerfCounters::Values counters;
+	};
+
+	struct ThreadBuffer {
+		std::thread::id owner;
+		int thread;
+		int currentName;
+		std::vector<std::string> strings;
+		std::map<std::string, int> stringIds;
+		std::vector<OpenScope> open;
+		std::vector<Sample> samples;
+		PerfCounters* counters;     // opened on first use if enabled
+
+		ThreadBuffer() : counters(0) { }
+		~ThreadBuffer() { delete counters; }
+
+		int intern(const std::string& str);
+	};
+
+	unsigned long id_;
+	Clock::time_point epoch_;
+	std::mutex buffersMutex_;
+	std::vector<ThreadBuffer*> buffers_;
+	bool hardwareCounters_;
+	MemoryTracking memoryTracking_;
+
+	ThreadBuffer& buffer();
+	ThreadBuffer* addBuffer(std::thread::id owner, int thread);
+	const PerfCounters* counters(ThreadBuffer& b);
+
+private:
+	TimeManager(const TimeManager&);
+	TimeManager& operator=(const TimeManager&);
 	
 public:
 	TimeManager();
 	virtual ~TimeManager();
 	
+	// also read cycles, instructions, LLC and branch misses for every phase;
+	// where perf_event_open is refused only the times are kept
+	void setHardwareCounters(bool enable) { hardwareCounters_ = enable; }
+
+	// also record rss at every start and stop, and with MEMORY_HEAP the live
+	// heap too; set before any phase is timed
+	void setMemoryTracking(MemoryTracking tracking) { memoryTracking_ = tracking; }
+
 	void start(const std::string& str);
 	void stop(const std::string& str);
 
+	// the name applies to the calling thread's samples only
 	void setName(const std::string& name);
 	void unsetName();
 	
+	void summarize(std::map<std::string, PhaseSummary>& phases);
 	void outputTimes();
+
+	// per phase and per label, how much memory was resident and how much
+	// each phase grew the heap; prints nothing if memory was not tracked
+	void outputMemory();
+
+	// every sample as a Chrome trace-event file, one track per thread, for
+	// chrome://tracing or Perfetto; returns false if the file can't be written
+	bool writeTrace(const std::string& fileName);
+};
+
+// times the enclosing scope as one phase
+class TimeScope
+{
+	TimeManager& tm_;
+	std::string category_;
+
+public:
+	TimeScope(TimeManager& tm, const std::string& category) : tm_(tm), category_(category) { tm_.start(category_); }
+	~TimeScope() { tm_.stop(category_); }
 };
 
 #endif /*TIMEMANAGER_H_*/
@@ -17,16 +17,19 @@ TimeUtil::TimeUtil(const TimeUtil& tu)
 	
 void 
 TimeUtil::start() {
-	gettimeofday(&this->startTime, NULL);
+	this->startTime = std::chrono::steady_clock::now();
 }
 
 void 
 TimeUtil::stop() {
-	gettimeofday(&this->stopTime, NULL);	
+	this->stopTime = std::chrono::steady_clock::now();
+}
+
+double
+TimeUtil::seconds() const {
+	return std::chrono::duration<double>(stopTime - startTime).count();
 }
 
 std::ostream& operator<<(std::ostream& os, const TimeUtil& tu) {
-	double diff = tu.stopTime.tv_sec - tu.startTime.tv_sec;
-	diff += (tu.stopTime.tv_usec - tu.startTime.tv_usec) / (1000.0 * 1000.0);
-	return os << diff << "s";
+	return os << tu.seconds() << "s";
 }
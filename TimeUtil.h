@@ -1,15 +1,14 @@
 #ifndef TIMEUTIL_H_
 #define TIMEUTIL_H_
 
-#include <time.h>
-#include <sys/time.h>
+#include <chrono>
 #include <iostream>
 
 class TimeUtil
 {
 private:
-	struct timeval startTime;
-	struct timeval stopTime;
+	std::chrono::steady_clock::time_point startTime;
+	std::chrono::steady_clock::time_point stopTime;
 	
 public:
 	friend std::ostream& operator<<(std::ostream& os, const TimeUtil& tu);
@@ -23,6 +22,7 @@ public:
 	
 	void start();
 	void stop();
+	double seconds() const;
 };
 
 #endif /*TIMEUTIL_H_*/
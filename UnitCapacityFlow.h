@@ -0,0 +1,219 @@
+#pragma once
+
+#include <lemon/core.h>
+#include <vector>
+#include <algorithm>
+
+// Dinic's blocking-flow max flow, laid out for the networks SimpGraph
+// builds: every finite capacity is a unit declassifier split arc and the
+// rest are INFINITY_HACK, so the flow value is bounded by the number of
+// declassifiers and the Even-Tarjan O(E sqrt V) bound applies.  the
+// residual network is a flat CSR copy of the input; arcs 2k and 2k+1 are
+// the forward and backward residuals of the k-th input arc.  the public
+// interface mirrors the parts of lemon::Preflow that SimpGraph uses.
+template<class GR, class CAP>
+class UnitCapacityFlow
+{
+public:
+	typedef typename GR::Node Node;
+	typedef typename GR::Arc Arc;
+	typedef typename GR::NodeIt NodeIt;
+	typedef typename GR::ArcIt ArcIt;
+	typedef typename GR::OutArcIt OutArcIt;
+	typedef typename GR::InArcIt InArcIt;
+	typedef typename CAP::Value Value;
+
+	class FlowMap {
+		const UnitCapacityFlow& flow_;
+	public:
+		FlowMap(const UnitCapacityFlow& flow) : flow_(flow) { }
+		Value operator[](const Arc& arc) const { return flow_.flow(arc); }
+	};
+
+protected:
+	const GR& graph_;
+	const CAP& capacity_;
+	Node source_;
+	Node target_;
+
+	std::vector<int> nodeIndex_;   // GR::id(node) -> dense index
+	std::vector<int> arcIndex_;    // GR::id(arc) -> input arc number k
+
+	std::vector<int> first_;       // CSR offsets into adjacent_
+	std::vector<int> adjacent_;    // residual arc numbers, grouped by tail
+	std::vector<int> head_;        // residual arc -> head node index
+	std::vector<Value> residual_;  // residual capacity
+
+	std::vector<int> level_;
+	std::vector<int> current_;
+	std::vector<int> queue_;
+	std::vector<int> path_;
+
+	Value flowValue_;
+	int phases_;
+
+	void build() {
+		int numNodes = 0;
+		nodeIndex_.assign(graph_.maxNodeId() + 1, -1);
+		for(NodeIt v(graph_); v != lemon::INVALID; ++v)
+			nodeIndex_[graph_.id(v)] = numNodes++;
+
+		int numArcs = 0;
+		arcIndex_.assign(graph_.maxArcId() + 1, -1);
+		for(ArcIt e(graph_); e != lemon::INVALID; ++e)
+			arcIndex_[graph_.id(e)] = numArcs++;
+
+		first_.assign(numNodes + 1, 0);
+		head_.resize(2 * numArcs);
+		residual_.resize(2 * numArcs);
+		std::vector<int> tail(2 * numArcs);
+		for(ArcIt e(graph_); e != lemon::INVALID; ++e) {
+			int k = arcIndex_[graph_.id(e)];
+			int u = nodeIndex_[graph_.id(graph_.source(e))];
+			int v = nodeIndex_[graph_.id(graph_.target(e))];
+			tail[2 * k] = u;
+			head_[2 * k] = v;
+			residual_[2 * k] = capacity_[e];
+			tail[2 * k + 1] = v;
+			head_[2 * k + 1] = u;
+			residual_[2 * k + 1] = 0;
+			++first_[u + 1];
+			++first_[v + 1];
+		}
+		for(int i = 0; i < numNodes; ++i)
+			first_[i + 1] += first_[i];
+
+		adjacent_.resize(2 * numArcs);
+		std::vector<int> fill(first_.begin(), first_.end() - 1);
+		for(int a = 0; a < 2 * numArcs; ++a)
+			adjacent_[fill[tail[a]]++] = a;
+
+		level_.resize(numNodes);
+		current_.resize(numNodes);
+		queue_.reserve(numNodes);
+	}
+
+	bool bfs(int s, int t) {
+		std::fill(level_.begin(), level_.end(), -1);
+		queue_.clear();
+		level_[s] = 0;
+		queue_.push_back(s);
+		for(size_t q = 0; q < queue_.size(); ++q) {
+			int u = queue_[q];
+			for(int i = first_[u]; i < first_[u + 1]; ++i) {
+				int a = adjacent_[i];
+				if (residual_[a] > 0 && level_[head_[a]] < 0) {
+					level_[head_[a]] = level_[u] + 1;
+					queue_.push_back(head_[a]);
+				}
+			}
+		}
+		return level_[t] >= 0;
+	}
+
+	// one blocking flow along the level graph, without recursion
+	Value blockingFlow(int s, int t) {
+		Value total = 0;
+		for(size_t i = 0; i < current_.size(); ++i)
+			current_[i] = first_[i];
+
+		path_.clear();
+		int u = s;
+		for (;;) {
+			if (u == t) {
+				Value bottleneck = residual_[path_[0]];
+				for(size_t i = 1; i < path_.size(); ++i)
+					bottleneck = std::min(bottleneck, residual_[path_[i]]);
+				size_t retreat = path_.size();
+				for(size_t i = 0; i < path_.size(); ++i) {
+					residual_[path_[i]] -= bottleneck;
+					residual_[path_[i] ^ 1] += bottleneck;
+					if (residual_[path_[i]] == 0 && retreat == path_.size())
+						retreat = i;
+				}
+				total += bottleneck;
+				path_.resize(retreat);
+				u = path_.empty() ? s : head_[path_.back()];
+				continue;
+			}
+
+			int& i = current_[u];
+			while (i < first_[u + 1]) {
+				int a = adjacent_[i];
+				if (residual_[a] > 0 && level_[head_[a]] == level_[u] + 1)
+					break;
+				++i;
+			}
+
+			if (i < first_[u + 1]) {
+				path_.push_back(adjacent_[i]);
+				u = head_[adjacent_[i]];
+			}
+			else {
+				// dead end: drop u from the level graph and back up
+				level_[u] = -1;
+				if (path_.empty())
+					return total;
+				path_.pop_back();
+				u = path_.empty() ? s : head_[path_.back()];
+				++current_[u];
+			}
+		}
+	}
+
+public:
+	UnitCapacityFlow(const GR& graph, const CAP& capacity, Node source, Node target) :
+		graph_(graph), capacity_(capacity), source_(source), target_(target), flowValue_(0), phases_(0) { }
+
+	// the zero flow
+	void init() {
+		build();
+		flowValue_ = 0;
+		phases_ = 0;
+	}
+
+	// starts from a given feasible flow instead, like Preflow::init(flowMap)
+	template<class FM>
+	void init(const FM& flowMap) {
+		init();
+		for(ArcIt e(graph_); e != lemon::INVALID; ++e) {
+			int k = arcIndex_[graph_.id(e)];
+			residual_[2 * k] -= flowMap[e];
+			residual_[2 * k + 1] += flowMap[e];
+		}
+		for(OutArcIt e(graph_, source_); e != lemon::INVALID; ++e)
+			flowValue_ += flowMap[e];
+		for(InArcIt e(graph_, source_); e != lemon::INVALID; ++e)
+			flowValue_ -= flowMap[e];
+	}
+
+	// augments the current flow to a maximum one
+	void start() {
+		int s = nodeIndex_[graph_.id(source_)];
+		int t = nodeIndex_[graph_.id(target_)];
+		// the last, failing bfs leaves level_ as the residual reachability
+		// from the source, which is the source side of the minimum cut
+		while (bfs(s, t)) {
+			++phases_;
+			flowValue_ += blockingFlow(s, t);
+		}
+	}
+
+	void run() {
+		init();
+		start();
+	}
+
+	Value flowValue() const { return flowValue_; }
+	int phases() const { return phases_; }
+
+	Value flow(const Arc& arc) const {
+		return residual_[2 * arcIndex_[graph_.id(arc)] + 1];
+	}
+	FlowMap flowMap() const { return FlowMap(*this); }
+
+	// true if node is on the source side of the minimum cut
+	bool minCut(const Node& node) const {
+		return level_[nodeIndex_[graph_.id(node)]] >= 0;
+	}
+};
@@ -1,9 +1,16 @@
 #define TIXML_USE_STL
 #include "tinyxml.h"
+#include "ConstraintReader.h"
+#include "ConstraintGraphBuilder.h"
 #include "SimpGraph.h"
+#include "LabelGraph.h"
+#include "LabelReachability.h"
+#include "ResidualCut.h"
 #include "TimeUtil.h"
 #include "TimeManager.h"
 #include "GraphStats.h"
+#include "Lattice.h"
+#include "GraphCache.h"
 
 #include <iostream>
 #include <iomanip> 
@@ -13,18 +20,75 @@
 #include <string>
 #include <stdlib.h>
 #include <stdio.h>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 
 using namespace lemon; 
 
 void do_minimum_cut_on_lgf_graph(const std::string& filename);
-void do_xml_read(const std::string& filename);
+struct AnalysisOptions {
+	int numThreads;
+	FlowEngine flowEngine;
+	bool warmStart;
+	std::string traceFile;          // Chrome trace-event output, if set
+	bool hardwareCounters;
+	TimeManager::MemoryTracking memoryTracking;
+
+	AnalysisOptions() : numThreads(1), flowEngine(PREFLOW_ENGINE), warmStart(false), hardwareCounters(false), memoryTracking(TimeManager::MEMORY_OFF) { }
+};
+
+void do_xml_read(const std::string& filename, const AnalysisOptions& options);
+void do_compile(const std::string& filename, const std::string& binFilename);
+void do_bin_read(const std::string& binFilename, const AnalysisOptions& options);
 
 std::map<std::string, GraphStats> graphStats;
 
 int main(int argc, char *argv[]) { 
 
+	AnalysisOptions options;
+	while (argc > 3) {
+		std::string option(argv[1]);
+		std::string value(argv[2]);
+		if (option == "-warm" || option == "-counters") {
+			if (option == "-warm")
+				options.warmStart = true;
+			else
+				options.hardwareCounters = true;
+			--argc;
+			++argv;
+			continue;
+		}
+		if (option == "-j")
+			options.numThreads = std::max(1, atoi(argv[2]));
+		else if (option == "-flow" && value == "preflow")
+			options.flowEngine = PREFLOW_ENGINE;
+		else if (option == "-flow" && value == "unit")
+			options.flowEngine = UNIT_CAPACITY_ENGINE;
+		else if (option == "-trace")
+			options.traceFile = value;
+		else if (option == "-memory" && value == "rss")
+			options.memoryTracking = TimeManager::MEMORY_RSS;
+		else if (option == "-memory" && value == "heap")
+			options.memoryTracking = TimeManager::MEMORY_HEAP;
+		else
+			break;
+		argc -= 2;
+		argv += 2;
+	}
+
+	if (argc == 4 && std::string(argv[1]) == "-compile") {
+		do_compile(argv[2], argv[3]);
+		std::cout << "all done!" << std::endl;
+		return 0;
+	}
+
 	if (argc != 3) {
-		std::cout << "missing argument: specify a filename with either -xml or -lgf" << std::endl;
+		std::cout << "missing argument: specify a filename with either -xml, -lgf or -bin (optionally preceded by -j N, -flow preflow|unit, -warm, -counters, -memory rss|heap, -trace file.json), or -compile file.xml file.bin" << std::endl;
 		return 0;
 	}
 
@@ -37,7 +101,10 @@ int main(int argc, char *argv[]) {
 		do_minimum_cut_on_lgf_graph(fileName);
 	}
 	else if (arg == "-xml") {
-		do_xml_read(fileName);
+		do_xml_read(fileName, options);
+	}
+	else if (arg == "-bin") {
+		do_bin_read(fileName, options);
 	}
 
 	std::cout << "all done!" << std::endl; 
@@ -94,34 +161,8 @@ void do_minimum_cut_on_lgf_graph(const std::string& filename) {
 	//	  }
 	//  }
 
-	FlowGraph saturatedGraph;
-	DigraphCopy<FlowGraph, FlowGraph> copyGraph(gr, saturatedGraph);
-	FlowGraph::ArcMap<FlowGraph::Arc> acr(saturatedGraph);
-	FlowGraph::NodeMap<FlowGraph::Node> ncr(saturatedGraph);
-	FlowGraph::ArcMap<FlowGraph::Arc> ar(gr);
-	FlowGraph::NodeMap<FlowGraph::Node> nr(gr);
-	copyGraph.arcCrossRef(acr).nodeCrossRef(ncr).nodeRef(nr).arcRef(ar);
-	copyGraph.run();
-
-	for(ArcIt e(gr); e != INVALID; ++e) {
-		saturatedGraph.erase(ar[e]);
-	}
-
-	for(ArcIt e(gr); e != INVALID; ++e) {
-		Node source = nr[gr.source(e)];
-		Node target = nr[gr.target(e)];
-
-		if (preflow_test.flowMap()[e] < cap[e]) {
-			saturatedGraph.addArc(source,target);
-		}
-		if (preflow_test.flowMap()[e] > 0) {
-			saturatedGraph.addArc(target,source);
-		}
-	}
-
-	Dfs<FlowGraph> dfsAgent(saturatedGraph);
-	//  dfsAgent.processedMap(processedMap);
-	dfsAgent.run(nr[s]);
+	CutMap sourceSide(gr);
+	residualSourceSide(gr, cap, preflow_test.flowMap(), s, sourceSide);
 
 	for(ArcIt e(gr); e != INVALID; ++e) {
 		Node source = gr.source(e);
@@ -130,7 +171,7 @@ void do_minimum_cut_on_lgf_graph(const std::string& filename) {
 		//	  std::cout << "investigating edge: " << nodeStr[gr.source(e)] << " -> " << nodeStr[gr.target(e)] << std::endl;
 		//	  std::cout << "\t(" << dfsAgent.reached(nr[source]) << "," << dfsAgent.reached(nr[target]) << ")" << std::endl; 
 
-		if (dfsAgent.reached(nr[source]) == true && dfsAgent.reached(nr[target]) == false) {
+		if (sourceSide[source] && !sourceSide[target]) {
 			std::cout << "cut: " << nodeStr[source] << " -> " << nodeStr[target] << " (" << nodeLabelMap[source] << "," << nodeLabelMap[target] << ")" << std::endl;
 		}
 	}
@@ -153,179 +194,208 @@ void do_minimum_cut_on_lgf_graph(const std::string& filename) {
 	std::cout << std::endl;
 }
 
-void do_xml_read(const std::string& filename) {
-  int numConstraints = 0;
-	TiXmlDocument doc(filename.c_str());
-	TimeManager tm;
-	tm.start("total time");
-	tm.start("read XML file");
-
-	bool loaded = doc.LoadFile(); 
-	if (!loaded) { 
-		std::cout << "could not load " << filename << std::endl; 
+struct LabelJob {
+	std::ostringstream output;
+	std::map<std::string, GraphStats> stats;
+	bool cut;
+	int flowValue;
+	int seededFlow;
+	bool done;
+
+	LabelJob() : cut(false), flowValue(0), seededFlow(0), done(false) { }
+};
+
+// shared state for analysing the lattice labels, possibly across threads
+struct LabelAnalysis {
+	const SimpGraph& flowGraph;
+	const Lattice& securityLattice;
+	const LabelReachability& reachability;
+	GraphStats baseGraphStats;
+	std::vector<LabelJob> jobs;
+	std::vector<int> plan;          // the order labels are analysed in
+
+	std::atomic<int> nextLabel;     // next position in plan
+	std::mutex doneMutex;
+	std::condition_variable doneCond;
+
+	AnalysisOptions options;
+
+	LabelAnalysis(const SimpGraph& flowGraph_, const Lattice& securityLattice_, const LabelReachability& reachability_, const GraphStats& baseGraphStats_, int numLabels, const AnalysisOptions& options_) :
+		flowGraph(flowGraph_), securityLattice(securityLattice_), reachability(reachability_), baseGraphStats(baseGraphStats_), jobs(numLabels), nextLabel(0), options(options_) { }
+};
+
+void analyze_label(LabelAnalysis& analysis, LabelGraph& labelGraph, TimeManager& tm, int i) {
+	LabelJob& job = analysis.jobs[i];
+	std::string iString(Lattice::labelNodeName(i));
+	std::string incompString;
+
+	std::set<int> incompIds;
+	analysis.securityLattice.getIncomparable(i, incompIds);
+	std::string currentName = iString;
+	for(std::set<int>::iterator itIncomp = incompIds.begin();
+		itIncomp != incompIds.end();
+		++itIncomp) {
+		incompString += Lattice::labelNodeName(*itIncomp) + " ";
 	}
 
-	SimpGraph flowGraph(tm);	
-	std::map<std::string,int> latticeIds;
-	std::set< std::pair<int, int> > latticeLeqs;
-	std::multimap<int, int> checkNotLeq;
-	int maxId = 0;
+	job.output << "------------------------------------------------" << std::endl;
+	job.output << iString << " ~> " << incompString << std::endl;
+	job.output << "------------------------------------------------" << std::endl;
 
-	TiXmlElement* root = doc.FirstChildElement( "constraint-set" );
+	job.stats[iString] = analysis.baseGraphStats;
 
-	if (!root) {
-		std::cout << "no root" << std::endl;
+	// a label whose node reaches none of its sinks has no source-to-sink
+	// path, and with no path there is no flow; report it without pruning
+	// or cutting
+	if (!analysis.reachability.reachesSink(i)) {
+		job.output << "no leak" << std::endl;
 		return;
 	}
 
-	//std::cout << "we got a root!" << std::endl;
-	// children of root are constraints
-	for (TiXmlNode* child = root->FirstChild();
-	child != 0;
-	child = child->NextSibling()) {
-	  if (child->Value() != NULL && std::string(child->Value()) == "con") {
-			//std::cout << "con: " << child->Value() << std::endl;
-	    ++numConstraints;
-			TiXmlElement* lhs = child->FirstChildElement("lhs");
-			TiXmlElement* rhs = child->FirstChildElement("rhs");
-
-			//			if (lhs)
-			//				lhs->
-			//				std::cout << lhs->Attribute("name") << std::endl;
-			//			if (rhs)
-			//				std::cout << rhs->Attribute("name") << std::endl;
-			if (lhs->FirstChildElement()->Attribute("name") == NULL || rhs->Attribute("name") == NULL) {
-			      std::cout << "skipping a constraint without names" << std::endl;
-			      continue;
-			    }
-
-			std::string lhsName(lhs->FirstChildElement()->Attribute("name"));
-			std::string rhsName(rhs->Attribute("name"));
-			//std::cout << lhsName << " <= " << rhsName << std::endl;
-
-			bool rhsDecl = false;
-			bool lhsDecl = false;
-
-			if (rhs->Attribute("canDecl") != NULL || rhsName.find("NV") != std::string::npos)
-				rhsDecl = true;
-			if (lhs->FirstChildElement()->Attribute("canDecl") != NULL  || lhsName.find("NV") != std::string::npos)
-				lhsDecl = true;
-
-			flowGraph.addNameConnection(lhsName, lhsDecl, rhsName, rhsDecl);
-
-			if (rhsDecl && child->FirstChildElement("asString") != NULL) {
-				TiXmlElement* asStringElem = child->FirstChildElement("asString");
-				std::string constraintString(asStringElem->FirstChild()->Value());
-				
-				TiXmlElement* becauseElem = child->FirstChildElement("because");
-				std::string becauseString(becauseElem->FirstChild()->Value());
-
-				std::string posString(child->FirstChildElement("pos")->FirstChild()->Value());
-
-				if (constraintString.find("_{def}") > 0) {
-				  flowGraph.addNamePositionConnection(rhsName, posString);
-				  flowGraph.addAsString(rhsName, becauseString);
-				}
-			}
+	tm.setName(currentName);
+	tm.start("analyze label");
+	labelGraph.reset();
+	labelGraph.pruneFlowGraph(analysis.reachability, i);
 
-			 
+	GraphStats prunedGraphStats;
+	labelGraph.getStats(prunedGraphStats);
+	job.stats[iString + " (pruned)"] = prunedGraphStats;
 
-			// for now ignore the other stuff
-		}
-		else if (child->Value() != NULL && std::string(child->Value()) == "lattice") {
-			for (TiXmlElement* latticeChild = child->FirstChildElement();
-			latticeChild != 0;
-			latticeChild = latticeChild->NextSiblingElement()) {
-				std::string latticeChildValue(latticeChild->Value());
-				if (latticeChildValue == "label") {
-					int id;
-					if (latticeChild->QueryIntAttribute("id", &id) == TIXML_SUCCESS)
-						latticeIds[latticeChild->Attribute("name")] = id;
-				}
-				if (latticeChildValue == "lt") {
-					int lhsId, rhsId;
-					if (latticeChild->QueryIntAttribute("lhs", &lhsId) == TIXML_SUCCESS &&
-							latticeChild->QueryIntAttribute("rhs", &rhsId) == TIXML_SUCCESS) {
-						if (lhsId > maxId)
-							maxId = lhsId;
-						if (rhsId > maxId)
-							maxId = rhsId;
-						latticeLeqs.insert(std::pair<int,int>(lhsId,rhsId));
-					}
-					else {
-						std::cout << "failure!" << std::endl;
-					}
-				}
-			}
-		}
-		else {
-			//std::cout << "unmatched: " << child->Value() << std::endl;
-		}
+	labelGraph.condenseFlowGraph();
 
-		std::set<std::pair<int,int> > pairsToCheck;
-		for(int i = 0; i <= maxId; ++i) {
-			for(int j = 0; j <= maxId; ++j) {
-				if (i != j && latticeLeqs.find(std::pair<int,int>(i,j)) == latticeLeqs.end())
-					checkNotLeq.insert(std::pair<int,int>(i,j));
-			}
-		}
+	GraphStats condensedGraphStats;
+	labelGraph.getCondensedStats(condensedGraphStats);
+	job.stats[iString + " (condensed)"] = condensedGraphStats;
 
-		//std::cout << "done with this one" << std::endl;
-		//flowGraph.outputToFile("out.dot");
+	labelGraph.performMinimumCut(job.output);
+	job.cut = true;
+	job.flowValue = labelGraph.getFlowValue();
+	job.seededFlow = labelGraph.getSeededFlow();
+	tm.stop("analyze label");
+	tm.unsetName();
+}
+
+void label_worker(LabelAnalysis* analysis, TimeManager* tm) {
+	LabelGraph labelGraph(analysis->flowGraph, *tm);
+	labelGraph.setFlowEngine(analysis->options.flowEngine);
+	labelGraph.setWarmStart(analysis->options.warmStart);
+	for (;;) {
+		int p = analysis->nextLabel++;
+		if (p >= (int) analysis->plan.size())
+			return;
+		int i = analysis->plan[p];
+
+		analyze_label(*analysis, labelGraph, *tm, i);
+
+		std::lock_guard<std::mutex> lock(analysis->doneMutex);
+		analysis->jobs[i].done = true;
+		analysis->doneCond.notify_all();
+	}
+}
+
+// parses the constraint set and freezes the graph; baseGraphStats are taken
+// before the super sink is added
+bool read_xml_graph(const std::string& filename, SimpGraph& flowGraph, Lattice& securityLattice, GraphStats& baseGraphStats, TimeManager& tm) {
+	tm.start("read XML file");
+
+	ConstraintGraphBuilder builder(flowGraph, securityLattice);
+	flowGraph.setMetadataSource(filename);
+
+	std::ifstream fileStream(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!fileStream) {
+		std::cout << "could not load " << filename << std::endl;
+	}
+
+	// constraints go into the graph as they are parsed; no DOM is kept
+	ConstraintReader reader(fileStream);
+	if (!reader.run(builder)) {
+		std::cout << "no root" << std::endl;
+		return false;
 	}
+
+	int numConstraints = builder.numConstraints;
 	tm.stop("read XML file");
 
+	tm.start("lattice closure");
+	securityLattice.computeReachability();
+	tm.stop("lattice closure");
+	int maxId = securityLattice.getMaxId();
+
 	std::cout << "read " << numConstraints << " constraints" << std::endl;
 
-	for(int i = 0; i <= maxId; ++i) {
-		char buffer[10];
-		sprintf(buffer,"%d",i);
-		std::string iString("LATTICE#" + std::string(buffer));
-		std::string incompString;
+	flowGraph.getStats(baseGraphStats);
+
+	// the base graph is frozen from here on; labels only overlay it
+	std::set<std::string> labelNames;
+	for(int i = 0; i <= maxId; ++i)
+		labelNames.insert(Lattice::labelNodeName(i));
+	flowGraph.prepareSuperSink(labelNames);
+	flowGraph.freeze();
+	return true;
+}
+
+void analyze_graph(const SimpGraph& flowGraph, const Lattice& securityLattice, const GraphStats& baseGraphStats, const AnalysisOptions& options, TimeManager& tm) {
+	int maxId = securityLattice.getMaxId();
 
+	// every label's keep set, from one forward and one backward pass
+	tm.start("label reachability");
+	LabelReachability reachability(flowGraph);
+	for(int i = 0; i <= maxId; ++i) {
 		std::set<std::string> incompNames;
-		std::multimap<int,int>::iterator itUnequal = checkNotLeq.find(i);
-		std::string currentName = iString;
-		if (itUnequal != checkNotLeq.end()) {
-			do {
-				//std::cout << itUnequal->first << "," << itUnequal->second << std::endl;
-				sprintf(buffer,"%d",itUnequal->second);
-				std::string name = "LATTICE#" + std::string(buffer);
-				if (incompNames.find(name) == incompNames.end())
-					incompString += name + " ";
-				incompNames.insert(name);
-				++itUnequal;
-			} while (itUnequal != checkNotLeq.upper_bound(i));
-		}
+		securityLattice.getIncomparableNames(i, incompNames);
+		reachability.addLabel(Lattice::labelNodeName(i), incompNames);
+	}
+	reachability.run();
+	tm.stop("label reachability");
+
+	int numSkipped = 0;
+	for(int i = 0; i <= maxId; ++i) {
+		if (!reachability.reachesSink(i))
+			++numSkipped;
+	}
+	std::cout << numSkipped << " of " << maxId + 1 << " labels reach no incomparable label" << std::endl;
+	std::cout << maxId + 1 << " labels in " << reachability.numGroups() << " sink groups" << std::endl;
+
+	// labels are analysed group by group so consecutive labels share their
+	// super sink arcs; the output below stays in lattice order
+	LabelAnalysis analysis(flowGraph, securityLattice, reachability, baseGraphStats, maxId + 1, options);
+	reachability.planOrder(analysis.plan);
+
+	// the workers record straight into tm; each thread gets its own buffer
+	std::vector<std::thread> workers;
+	if (options.numThreads > 1) {
+		int numWorkers = std::min(options.numThreads, maxId + 1);
+		for(int t = 0; t < numWorkers; ++t)
+			workers.push_back(std::thread(label_worker, &analysis, &tm));
+	}
+	LabelGraph labelGraph(flowGraph, tm);
+	labelGraph.setFlowEngine(options.flowEngine);
+	labelGraph.setWarmStart(options.warmStart);
 
-		std::cout << "------------------------------------------------" << std::endl;
-		std::cout << iString << " ~> " << incompString << std::endl;
-		std::cout << "------------------------------------------------" << std::endl;
-		
-		GraphStats thisGraphStats;
-		flowGraph.getStats(thisGraphStats);
-		graphStats[iString] = thisGraphStats;
-
-		tm.setName(currentName);
-		SimpGraph copyGraph(tm);
-		flowGraph.copySimpGraph(copyGraph);
-		copyGraph.pruneFlowGraph(iString,incompNames);
-
-		GraphStats prunedGraphStats;
-		copyGraph.getStats(prunedGraphStats);
-		graphStats[iString + " (pruned)"] = prunedGraphStats;
-
-		//copyGraph.outputToFile("out.dot");
-		copyGraph.performMinimumCut(iString);
-		tm.unsetName();
-		//       int firstId = flowGraph.getOutgoingIdForName(latticeFirst,false);
-		//       int secondId = flowGraph.getOutgoingIdForName(latticeSecond,false);
-
-		//       std::cout << "hi " << latticeFirst << " (" << firstId 
-		// 		<< ") not comparable with " << latticeSecond << " (" << secondId << ")" 
-		// 		<< std::endl;
+	// print each label as soon as it and everything before it are done, so
+	// the output is in lattice order regardless of which thread ran it
+	for(int i = 0; i <= maxId; ++i) {
+		if (workers.empty()) {
+			while (!analysis.jobs[i].done) {
+				int planned = analysis.plan[analysis.nextLabel++];
+				analyze_label(analysis, labelGraph, tm, planned);
+				analysis.jobs[planned].done = true;
+			}
+		}
+		else {
+			std::unique_lock<std::mutex> lock(analysis.doneMutex);
+			while (!analysis.jobs[i].done)
+				analysis.doneCond.wait(lock);
+		}
 
+		LabelJob& job = analysis.jobs[i];
+		std::cout << job.output.str();
+		graphStats.insert(job.stats.begin(), job.stats.end());
 	}
+
+	for(size_t t = 0; t < workers.size(); ++t)
+		workers[t].join();
+
 	tm.stop("total time");
 	
 	std::cout << std::fixed << std::setprecision(4);
@@ -338,5 +408,71 @@ void do_xml_read(const std::string& filename) {
 	    ++itStats) {
 	  std::cout << std::left << std::setw(25) << itStats->first  << ": " << itStats ->second.num_nodes << " nodes, " << itStats->second.num_edges << " edges" << std::endl;
 	}
+	if (options.warmStart) {
+		// each seeded unit is an augmenting path the flow did not search for
+		int totalFlow = 0, totalSeeded = 0;
+		for(int i = 0; i <= maxId; ++i) {
+			const LabelJob& job = analysis.jobs[i];
+			if (!job.cut)
+				continue;
+			std::cout << std::left << std::setw(25) << Lattice::labelNodeName(i) + " (warm)" << ": " << job.seededFlow << " of " << job.flowValue << " flow units seeded" << std::endl;
+			totalFlow += job.flowValue;
+			totalSeeded += job.seededFlow;
+		}
+		std::cout << std::left << std::setw(25) << "warm start" << ": " << totalSeeded << " of " << totalFlow << " flow units seeded" << std::endl;
+	}
 	tm.outputTimes();
+	tm.outputMemory();
+	if (!options.traceFile.empty() && tm.writeTrace(options.traceFile))
+		std::cout << "wrote trace " << options.traceFile << std::endl;
+}
+
+void do_xml_read(const std::string& filename, const AnalysisOptions& options) {
+	TimeManager tm;
+	tm.setHardwareCounters(options.hardwareCounters);
+	tm.setMemoryTracking(options.memoryTracking);
+	tm.start("total time");
+
+	SimpGraph flowGraph(tm);
+	Lattice securityLattice;
+	GraphStats baseGraphStats;
+	if (!read_xml_graph(filename, flowGraph, securityLattice, baseGraphStats, tm))
+		return;
+
+	analyze_graph(flowGraph, securityLattice, baseGraphStats, options, tm);
+}
+
+void do_compile(const std::string& filename, const std::string& binFilename) {
+	TimeManager tm;
+	SimpGraph flowGraph(tm);
+	Lattice securityLattice;
+	GraphStats baseGraphStats;
+	if (!read_xml_graph(filename, flowGraph, securityLattice, baseGraphStats, tm))
+		return;
+
+	tm.start("write binary");
+	bool written = GraphCache::write(binFilename, flowGraph, securityLattice, baseGraphStats);
+	tm.stop("write binary");
+	if (written)
+		std::cout << "wrote " << binFilename << std::endl;
+	tm.outputTimes();
+	tm.outputMemory();
+}
+
+void do_bin_read(const std::string& binFilename, const AnalysisOptions& options) {
+	TimeManager tm;
+	tm.setHardwareCounters(options.hardwareCounters);
+	tm.setMemoryTracking(options.memoryTracking);
+	tm.start("total time");
+
+	tm.start("load binary");
+	SimpGraph flowGraph(tm);
+	Lattice securityLattice;
+	GraphStats baseGraphStats;
+	bool loaded = GraphCache::load(binFilename, flowGraph, securityLattice, baseGraphStats);
+	tm.stop("load binary");
+	if (!loaded)
+		return;
+
+	analyze_graph(flowGraph, securityLattice, baseGraphStats, options, tm);
 }